@@ -11,21 +11,37 @@
   <image source="../../../Desktop/tiles/computer.png" width="32" height="32"/>
  </tile>
  <tile id="3">
+  <properties>
+   <property name="solid" type="bool" value="true"/>
+  </properties>
   <image source="../../../Desktop/tiles/dirt.png" width="32" height="32"/>
  </tile>
  <tile id="4">
   <image source="../../../Desktop/tiles/doorway.png" width="32" height="32"/>
  </tile>
  <tile id="5">
+  <properties>
+   <property name="one-way" type="bool" value="true"/>
+  </properties>
   <image source="../../../Desktop/tiles/floor.png" width="32" height="32"/>
  </tile>
  <tile id="6">
+  <properties>
+   <property name="foreground" type="bool" value="true"/>
+  </properties>
   <image source="../../../Desktop/tiles/grass.png" width="32" height="32"/>
  </tile>
  <tile id="7">
+  <properties>
+   <property name="solid" type="bool" value="true"/>
+  </properties>
   <image source="../../../Desktop/tiles/ground.png" width="32" height="32"/>
  </tile>
  <tile id="8">
+  <properties>
+   <property name="breakable" type="bool" value="true"/>
+   <property name="solid" type="bool" value="true"/>
+  </properties>
   <image source="../../../Desktop/tiles/panel.png" width="32" height="32"/>
  </tile>
  <tile id="9">
@@ -35,6 +51,9 @@
   <image source="../../../Desktop/tiles/underground.png" width="32" height="32"/>
  </tile>
  <tile id="11">
+  <properties>
+   <property name="foreground" type="bool" value="true"/>
+  </properties>
   <image source="../../../Desktop/tiles/weed.png" width="32" height="32"/>
  </tile>
 </tileset>
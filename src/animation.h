@@ -1,27 +1,58 @@
 #pragma once
+#include "spritesheet.h"
 #include "timer.h"
 
 class Animation
 {
 	Timer timer;
-	int frameCount;
+	SpriteClip const *clip;
+	int frameIndex;
 
 public:
-	Animation() : timer(0), frameCount(0) {}
-	Animation(int frameCount, float length) : frameCount(frameCount), timer(length)
+	Animation() : timer(0), clip(nullptr), frameIndex(0) {}
+	Animation(SpriteClip const &clip) : timer(clip.length), clip(&clip), frameIndex(0)
+	{
+	}
+	// Resumes a clip with saved progress
+	Animation(SpriteClip const &clip, Timer const &timer, int frameIndex) : timer(timer), clip(&clip), frameIndex(frameIndex)
 	{
 	}
 
 	float getLength() const { return timer.getLength(); }
-	int currentFrame() const
+	SpriteClip const *getClip() const { return clip; }
+	Timer const &getTimer() const { return timer; }
+	int currentFrame() const { return frameIndex; }
+
+	SpriteFrame const &frame(bool mirrored) const
 	{
-		return static_cast<int>(timer.getTime() / timer.getLength() * frameCount);
+		return clip->frames[mirrored][frameIndex];
 	}
 
 	void step(float deltaTime)
 	{
-		timer.step(deltaTime);
+		int const last = static_cast<int>(clip->frameEnds.size()) - 1;
+		if (!clip->loop && timer.isTimeout())
+		{
+			return; // holds the last frame
+		}
+		if (timer.step(deltaTime))
+		{
+			if (!clip->loop)
+			{
+				frameIndex = last;
+				return;
+			}
+			frameIndex = 0;
+		}
+
+		// Advance the frame as time passes its end, usually zero or one step
+		while (frameIndex < last && timer.getTime() >= clip->frameEnds[frameIndex])
+		{
+			frameIndex++;
+		}
 	}
 
 	bool isDone() const { return timer.isTimeout(); }
+	// Whether the clip is done once pending seconds not stepped yet are added
+	bool isDone(float pending) const { return timer.isTimeout() || timer.getTime() + pending >= timer.getLength(); }
 };
@@ -0,0 +1,228 @@
+#pragma once
+#include <vector>
+#include <SDL3/SDL.h>
+#include "render.h"
+
+struct ParallaxLayer
+{
+	SDL_Texture *texture;
+	SDL_Texture *strip; // texture pre-tiled to cover the view width
+	float y;
+	float scrollPos, prevScrollPos, bakedScrollPos;
+
+	ParallaxLayer(SDL_Texture *texture, float y) : texture(texture), strip(nullptr), y(y)
+	{
+		scrollPos = prevScrollPos = bakedScrollPos = 0;
+	}
+};
+
+// Keeps the full-screen base image and every parallax layer that is not
+// scrolling baked into a single opaque texture. Layers that are scrolling are
+// drawn from a wrap-around strip with at most two quads each.
+class ParallaxBackground
+{
+	SDL_Renderer *renderer;
+	SDL_Texture *base, *baked;
+	SDL_Color clearColor;
+	int width, height;
+	std::vector<ParallaxLayer> layers;
+	int bakedCount; // number of back-most layers included in the baked texture
+	bool bakedValid;
+	bool parallaxEnabled;
+
+	int layerCount() const { return parallaxEnabled ? static_cast<int>(layers.size()) : 0; }
+
+	void createStrip(RenderContext &gfx, ParallaxLayer &layer)
+	{
+		// Whole number of repetitions so the strip wraps seamlessly
+		int const repeat = (width + layer.texture->w - 1) / layer.texture->w;
+		if (!layer.strip)
+		{
+			layer.strip = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET,
+				layer.texture->w * repeat, layer.texture->h);
+			SDL_SetTextureScaleMode(layer.strip, SDL_SCALEMODE_NEAREST);
+			SDL_SetTextureBlendMode(layer.strip, SDL_BLENDMODE_BLEND);
+		}
+
+		SDL_Texture *prevTarget = gfx.getTarget();
+		gfx.setTarget(layer.strip);
+		gfx.setDrawColor(0, 0, 0, 0);
+		gfx.clear();
+		SDL_FRect dst {
+			.x = 0,
+			.y = 0,
+			.w = static_cast<float>(layer.strip->w),
+			.h = static_cast<float>(layer.strip->h),
+		};
+		gfx.renderTextureTiled(layer.texture, nullptr, 1, &dst);
+		gfx.setTarget(prevTarget);
+	}
+
+	void drawStrip(RenderContext &gfx, ParallaxLayer const &layer, float scrollPos)
+	{
+		float const stripW = static_cast<float>(layer.strip->w);
+		SDL_FRect dst {
+			.x = scrollPos,
+			.y = layer.y,
+			.w = stripW,
+			.h = static_cast<float>(layer.strip->h),
+		};
+		gfx.renderTexture(layer.strip, nullptr, &dst);
+
+		// Second quad only when the first one does not reach the right edge
+		if (dst.x + stripW < width)
+		{
+			dst.x += stripW;
+			gfx.renderTexture(layer.strip, nullptr, &dst);
+		}
+	}
+
+	void bake(RenderContext &gfx, int count)
+	{
+		SDL_Texture *prevTarget = gfx.getTarget();
+		gfx.setTarget(baked);
+		gfx.setDrawColor(clearColor.r, clearColor.g, clearColor.b, 255);
+		gfx.clear();
+		gfx.renderTexture(base, nullptr, nullptr);
+		for (int i = 0; i < count; i++)
+		{
+			drawStrip(gfx, layers[i], layers[i].scrollPos);
+			layers[i].bakedScrollPos = layers[i].scrollPos;
+		}
+		gfx.setTarget(prevTarget);
+
+		bakedCount = count;
+		bakedValid = true;
+	}
+
+public:
+	ParallaxBackground() : renderer(nullptr), base(nullptr), baked(nullptr), clearColor { 0 }
+	{
+		width = height = 0;
+		bakedCount = 0;
+		bakedValid = false;
+		parallaxEnabled = true;
+	}
+
+	void create(SDL_Renderer *r, int w, int h, SDL_Color clear, SDL_Texture *baseTexture)
+	{
+		renderer = r;
+		width = w;
+		height = h;
+		clearColor = clear;
+		base = baseTexture;
+		baked = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, width, height);
+		SDL_SetTextureScaleMode(baked, SDL_SCALEMODE_NEAREST);
+
+		// Fully opaque by construction, no need to blend it over anything
+		SDL_SetTextureBlendMode(baked, SDL_BLENDMODE_NONE);
+		bakedValid = false;
+	}
+
+	// Layers are drawn in the order they are added, back to front
+	int addLayer(SDL_Texture *texture, float y)
+	{
+		layers.push_back(ParallaxLayer(texture, y));
+		bakedValid = false;
+		return static_cast<int>(layers.size()) - 1;
+	}
+
+	float getLayerWidth(int layer) const { return static_cast<float>(layers[layer].texture->w); }
+
+	void setScroll(int layer, float scrollPos)
+	{
+		layers[layer].scrollPos = scrollPos;
+	}
+
+	// Swap a source texture, e.g. after it was reloaded with a different size
+	void replaceTexture(SDL_Texture *oldTex, SDL_Texture *newTex)
+	{
+		if (base == oldTex)
+		{
+			base = newTex;
+		}
+		for (ParallaxLayer &layer : layers)
+		{
+			if (layer.texture == oldTex)
+			{
+				layer.texture = newTex;
+			}
+		}
+		invalidate();
+	}
+
+	// When disabled only the base image is drawn
+	void setParallaxEnabled(bool enabled)
+	{
+		parallaxEnabled = enabled;
+	}
+
+	// Render target contents may be lost on device reset, rebuild on next draw
+	void invalidate()
+	{
+		for (ParallaxLayer &layer : layers)
+		{
+			SDL_DestroyTexture(layer.strip);
+			layer.strip = nullptr;
+		}
+		bakedValid = false;
+	}
+
+	void draw(RenderContext &gfx)
+	{
+		for (ParallaxLayer &layer : layers)
+		{
+			if (!layer.strip)
+			{
+				createStrip(gfx, layer);
+			}
+		}
+
+		// Back-most run of layers that did not move since last frame can be baked
+		int staticCount = 0;
+		while (staticCount < layerCount() &&
+			layers[staticCount].scrollPos == layers[staticCount].prevScrollPos)
+		{
+			staticCount++;
+		}
+
+		bool rebake = !bakedValid || staticCount != bakedCount;
+		for (int i = 0; i < staticCount && !rebake; i++)
+		{
+			rebake = layers[i].scrollPos != layers[i].bakedScrollPos;
+		}
+		if (rebake)
+		{
+			bake(gfx, staticCount);
+		}
+
+		// Explicit size so a scaled render target is only partially filled
+		SDL_FRect const dst {
+			.x = 0,
+			.y = 0,
+			.w = static_cast<float>(width),
+			.h = static_cast<float>(height),
+		};
+		gfx.renderTexture(baked, nullptr, &dst);
+		for (int i = bakedCount; i < layerCount(); i++)
+		{
+			drawStrip(gfx, layers[i], layers[i].scrollPos);
+		}
+
+		for (ParallaxLayer &layer : layers)
+		{
+			layer.prevScrollPos = layer.scrollPos;
+		}
+	}
+
+	void destroy()
+	{
+		for (ParallaxLayer &layer : layers)
+		{
+			SDL_DestroyTexture(layer.strip);
+		}
+		layers.clear();
+		SDL_DestroyTexture(baked);
+		baked = nullptr;
+	}
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+// Follows a target on both axes, only moving once the target leaves the
+// deadzone around the view center, and keeps the view inside the map bounds.
+class Camera
+{
+	glm::vec2 position; // top-left corner of the view in world space
+	glm::vec2 size;
+	glm::vec2 deadzone;
+	SDL_FRect bounds;
+
+	// Maps smaller than the view are placed by anchor: 0 at the near edge of
+	// the view, 0.5 centered, 1 at the far edge
+	float clampAxis(float pos, float viewSize, float min, float extent, float anchor) const
+	{
+		if (extent <= viewSize)
+		{
+			return min + (extent - viewSize) * anchor;
+		}
+		return std::clamp(pos, min, min + extent - viewSize);
+	}
+
+	// Narrow maps are centered, short ones stick to the bottom (the ground)
+	void clampToBounds()
+	{
+		position.x = clampAxis(position.x, size.x, bounds.x, bounds.w, 0.5f);
+		position.y = clampAxis(position.y, size.y, bounds.y, bounds.h, 1.0f);
+	}
+
+public:
+	Camera(float width, float height) : position(0), size(width, height), deadzone(0), bounds { 0, 0, width, height }
+	{
+	}
+
+	void setBounds(SDL_FRect const &mapBounds)
+	{
+		bounds = mapBounds;
+		clampToBounds();
+	}
+
+	void setDeadzone(float width, float height)
+	{
+		deadzone = glm::vec2(width, height);
+	}
+
+	void follow(glm::vec2 target)
+	{
+		glm::vec2 const center = position + size / 2.0f;
+		glm::vec2 const offset = target - center;
+		glm::vec2 const half = deadzone / 2.0f;
+		if (offset.x > half.x) position.x += offset.x - half.x;
+		if (offset.x < -half.x) position.x += offset.x + half.x;
+		if (offset.y > half.y) position.y += offset.y - half.y;
+		if (offset.y < -half.y) position.y += offset.y + half.y;
+		clampToBounds();
+	}
+
+	void snapTo(glm::vec2 target)
+	{
+		position = target - size / 2.0f;
+		clampToBounds();
+	}
+
+	SDL_FRect view() const
+	{
+		return SDL_FRect {
+			.x = position.x,
+			.y = position.y,
+			.w = size.x,
+			.h = size.y,
+		};
+	}
+
+	bool isVisible(SDL_FRect const &rect, float margin = 0) const
+	{
+		return rect.x + rect.w >= position.x - margin && rect.x <= position.x + size.x + margin &&
+			rect.y + rect.h >= position.y - margin && rect.y <= position.y + size.y + margin;
+	}
+
+	// 1 inside the view, fading linearly to 0 half a view width outside of it
+	float audibility(glm::vec2 pos) const
+	{
+		float const dx = std::max({ position.x - pos.x, pos.x - (position.x + size.x), 0.0f });
+		float const dy = std::max({ position.y - pos.y, pos.y - (position.y + size.y), 0.0f });
+		float const falloff = size.x / 2;
+		return std::max(0.0f, 1.0f - glm::length(glm::vec2(dx, dy)) / falloff);
+	}
+};
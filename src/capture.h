@@ -0,0 +1,230 @@
+#pragma once
+#include <atomic>
+#include <format>
+#include <string>
+#include <vector>
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+
+enum class CaptureFormat
+{
+	png, raw
+};
+
+// Records frames to disk. The main thread only reads the scene back into a
+// preallocated ring slot; encoding and file output happen on a writer thread.
+// When the writer falls behind frames are dropped instead of waiting.
+class FrameCapture
+{
+	struct Slot
+	{
+		std::vector<Uint8> pixels;
+		int width, height, pitch;
+		SDL_PixelFormat format;
+		int frameNumber;
+	};
+
+	static int const SLOT_COUNT = 8;
+	Slot slots[SLOT_COUNT];
+	int head, count; // filled slots, oldest first, guarded by mutex
+	SDL_Mutex *mutex;
+	SDL_Condition *filled;
+	SDL_Thread *thread;
+	bool running;
+	CaptureFormat format;
+	std::string directory;
+	int frameNumber;
+	std::atomic<int> written, dropped; // read by the main thread while the writer runs
+	double mainThreadTime; // seconds spent in capture() on the main thread
+	int captured;
+
+	static int writerThread(void *data)
+	{
+		static_cast<FrameCapture *>(data)->writeFrames();
+		return 0;
+	}
+
+	void writeFrames()
+	{
+		SDL_LockMutex(mutex);
+		while (running || count > 0)
+		{
+			if (count == 0)
+			{
+				SDL_WaitCondition(filled, mutex);
+				continue;
+			}
+			Slot &slot = slots[head];
+			SDL_UnlockMutex(mutex);
+
+			writeSlot(slot);
+
+			SDL_LockMutex(mutex);
+			head = (head + 1) % SLOT_COUNT;
+			count--;
+			written++;
+		}
+		SDL_UnlockMutex(mutex);
+	}
+
+	void writeSlot(Slot &slot)
+	{
+		if (format == CaptureFormat::png)
+		{
+			std::string const path = std::format("{}/frame_{:06}.png", directory, slot.frameNumber);
+			SDL_Surface *surface = SDL_CreateSurfaceFrom(slot.width, slot.height, slot.format,
+				slot.pixels.data(), slot.pitch);
+			if (!surface || !IMG_SavePNG(surface, path.c_str()))
+			{
+				SDL_Log("Capture: failed to write %s: %s", path.c_str(), SDL_GetError());
+			}
+			SDL_DestroySurface(surface);
+		}
+		else
+		{
+			std::string const path = std::format("{}/frame_{:06}.{}x{}.raw",
+				directory, slot.frameNumber, slot.width, slot.height);
+			SDL_IOStream *io = SDL_IOFromFile(path.c_str(), "wb");
+			if (!io)
+			{
+				SDL_Log("Capture: failed to open %s: %s", path.c_str(), SDL_GetError());
+				return;
+			}
+			// Rows are written tightly packed
+			for (int y = 0; y < slot.height; y++)
+			{
+				SDL_WriteIO(io, slot.pixels.data() + y * slot.pitch, slot.width * 4);
+			}
+			SDL_CloseIO(io);
+		}
+	}
+
+public:
+	FrameCapture() : head(0), count(0), mutex(nullptr), filled(nullptr), thread(nullptr), running(false),
+		format(CaptureFormat::png), frameNumber(0), written(0), dropped(0), mainThreadTime(0), captured(0)
+	{
+	}
+
+	~FrameCapture()
+	{
+		stop();
+	}
+
+	bool isRunning() const { return running; }
+	int getWritten() const { return written.load(); }
+	int getDropped() const { return dropped.load(); }
+	int getFrameNumber() const { return frameNumber; }
+
+	// Average main thread cost per captured frame in seconds
+	double getAverageCost() const { return captured ? mainThreadTime / captured : 0; }
+
+	void setFormat(CaptureFormat f) { format = f; }
+
+	bool start(std::string const &dir, int width, int height)
+	{
+		if (running)
+		{
+			return true;
+		}
+		if (!SDL_CreateDirectory(dir.c_str()))
+		{
+			SDL_Log("Capture: cannot create %s: %s", dir.c_str(), SDL_GetError());
+			return false;
+		}
+		directory = dir;
+
+		// Allocate every slot upfront so the ring never grows. The readback
+		// itself still gets a new surface from SDL every frame, plus a converted
+		// copy when the target is not 32 bits per pixel.
+		for (Slot &slot : slots)
+		{
+			slot.pixels.resize(static_cast<size_t>(width) * height * 4);
+		}
+		head = count = 0;
+		frameNumber = written = dropped = captured = 0;
+		mainThreadTime = 0;
+
+		mutex = SDL_CreateMutex();
+		filled = SDL_CreateCondition();
+		running = true;
+		thread = SDL_CreateThread(writerThread, "capture", this);
+		SDL_Log("Capture: started in %s", dir.c_str());
+		return true;
+	}
+
+	void stop()
+	{
+		if (!running)
+		{
+			return;
+		}
+		SDL_LockMutex(mutex);
+		running = false;
+		SDL_SignalCondition(filled);
+		SDL_UnlockMutex(mutex);
+
+		// Writer drains the queued frames before exiting
+		SDL_WaitThread(thread, nullptr);
+		SDL_DestroyCondition(filled);
+		SDL_DestroyMutex(mutex);
+		thread = nullptr;
+		filled = nullptr;
+		mutex = nullptr;
+		SDL_Log("Capture: stopped, %d frames written, %d dropped, %.3f ms per frame on the main thread",
+			written.load(), dropped.load(), getAverageCost() * 1000.0);
+	}
+
+	// Reads back the given area of the current render target into a free slot
+	void capture(SDL_Renderer *renderer, SDL_Rect const &area)
+	{
+		if (!running)
+		{
+			return;
+		}
+		uint64_t const begin = SDL_GetPerformanceCounter();
+		int const number = frameNumber++;
+
+		SDL_LockMutex(mutex);
+		bool const full = count == SLOT_COUNT;
+		int const index = (head + count) % SLOT_COUNT;
+		SDL_UnlockMutex(mutex);
+		if (full)
+		{
+			dropped++;
+			return;
+		}
+
+		// The slot past the filled ones is never touched by the writer
+		SDL_Surface *surface = SDL_RenderReadPixels(renderer, &area);
+		if (surface && SDL_BYTESPERPIXEL(surface->format) != 4)
+		{
+			SDL_Surface *converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+			SDL_DestroySurface(surface);
+			surface = converted;
+		}
+		if (!surface)
+		{
+			return;
+		}
+		Slot &slot = slots[index];
+		slot.width = surface->w;
+		slot.height = surface->h;
+		slot.pitch = surface->w * 4;
+		slot.format = surface->format;
+		slot.frameNumber = number;
+		for (int y = 0; y < surface->h; y++)
+		{
+			SDL_memcpy(slot.pixels.data() + y * slot.pitch,
+				static_cast<Uint8 *>(surface->pixels) + y * surface->pitch, slot.pitch);
+		}
+		SDL_DestroySurface(surface);
+
+		SDL_LockMutex(mutex);
+		count++;
+		SDL_SignalCondition(filled);
+		SDL_UnlockMutex(mutex);
+
+		mainThreadTime += static_cast<double>(SDL_GetPerformanceCounter() - begin) / SDL_GetPerformanceFrequency();
+		captured++;
+	}
+};
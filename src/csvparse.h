@@ -0,0 +1,281 @@
+#pragma once
+#include <SDL3/SDL.h>
+
+enum class CsvParser
+{
+	scalar, sse2, avx2
+};
+
+// Parser for the CSV body of a TMX <data> element: unsigned integers separated
+// by commas and line breaks. The SIMD versions classify a whole block of bytes
+// as digit or separator at once and convert the digits in the same pass, then
+// walk the numbers of the block with bit scans instead of testing every byte.
+class CsvTileParser
+{
+	// Running state of a number that may continue into the next block
+	struct Cursor
+	{
+		Uint32 *out;
+		size_t written, capacity;
+		Uint32 value;
+		bool inNumber;
+	};
+
+	static int countTrailingZeros(Uint64 bits)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(bits);
+#else
+		int n = 0;
+		while (!(bits & 1))
+		{
+			bits >>= 1;
+			n++;
+		}
+		return n;
+#endif
+	}
+
+	// A number carried over from the previous block ends at a leading separator
+	static void endCarried(Cursor &cur, Uint64 digitMask)
+	{
+		if (cur.inNumber && !(digitMask & 1))
+		{
+			cur.out[cur.written++] = cur.value;
+			cur.inNumber = false;
+		}
+	}
+
+	static int popCount(Uint64 bits)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_popcountll(bits);
+#else
+		int n = 0;
+		for (; bits; bits &= bits - 1)
+		{
+			n++;
+		}
+		return n;
+#endif
+	}
+
+	// digitMask has bit i set when byte i of the block is a digit, values holds
+	// every byte minus '0'. nextIsDigit tells whether the byte after the block is.
+	static void consumeBlock(Cursor &cur, Uint64 digitMask, Uint8 const *values, int width, bool nextIsDigit)
+	{
+		// Common case of single digit gids: every digit is a whole number
+		bool const lastContinues = nextIsDigit && (digitMask >> (width - 1) & 1);
+		if (!cur.inNumber && !(digitMask & (digitMask >> 1)) && !lastContinues &&
+			cur.written + popCount(digitMask) <= cur.capacity)
+		{
+			for (; digitMask; digitMask &= digitMask - 1)
+			{
+				cur.out[cur.written++] = values[countTrailingZeros(digitMask)];
+			}
+			return;
+		}
+
+		int i = 0;
+		while (i < width && cur.written < cur.capacity)
+		{
+			if (cur.inNumber)
+			{
+				// Bits past the block are clear in digitMask, so a run always ends
+				int const run = countTrailingZeros(~digitMask >> i);
+				int const stop = i + run < width ? i + run : width;
+				for (; i < stop; i++)
+				{
+					cur.value = cur.value * 10 + values[i];
+				}
+				if (i < width)
+				{
+					cur.out[cur.written++] = cur.value;
+					cur.inNumber = false;
+				}
+			}
+			else
+			{
+				Uint64 const ahead = digitMask >> i;
+				if (!ahead)
+				{
+					return;
+				}
+				i += countTrailingZeros(ahead);
+				cur.value = 0;
+				cur.inNumber = true;
+			}
+		}
+	}
+
+	static void consumeScalar(Cursor &cur, char const *p, char const *end)
+	{
+		for (; p < end && cur.written < cur.capacity; p++)
+		{
+			Uint8 const digit = static_cast<Uint8>(*p - '0');
+			if (digit < 10)
+			{
+				cur.value = cur.inNumber ? cur.value * 10 + digit : digit;
+				cur.inNumber = true;
+			}
+			else if (cur.inNumber)
+			{
+				cur.out[cur.written++] = cur.value;
+				cur.inNumber = false;
+			}
+		}
+	}
+
+	static size_t finish(Cursor &cur)
+	{
+		if (cur.inNumber && cur.written < cur.capacity)
+		{
+			cur.out[cur.written++] = cur.value;
+		}
+		return cur.written;
+	}
+
+public:
+	static size_t parseScalar(char const *p, size_t size, Uint32 *out, size_t capacity)
+	{
+		Cursor cur { out, 0, capacity, 0, false };
+		consumeScalar(cur, p, p + size);
+		return finish(cur);
+	}
+
+#ifdef SDL_SSE2_INTRINSICS
+	static size_t parseSse2(char const *p, size_t size, Uint32 *out, size_t capacity)
+	{
+		Cursor cur { out, 0, capacity, 0, false };
+		char const *end = p + size;
+		__m128i const zero = _mm_set1_epi8('0');
+		__m128i const nine = _mm_set1_epi8(9);
+		__m128i const lowByte = _mm_set1_epi16(0x00ff);
+		__m128i const none = _mm_setzero_si128();
+		alignas(16) Uint8 values[16];
+		for (; end - p >= 16 && cur.written < cur.capacity; p += 16)
+		{
+			__m128i const digits = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)), zero);
+			__m128i const isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, nine), digits);
+			Uint32 const mask = static_cast<Uint32>(_mm_movemask_epi8(isDigit));
+			bool const nextIsDigit = end - p > 16 && static_cast<Uint8>(p[16] - '0') < 10;
+			endCarried(cur, mask);
+
+			// "d,d,d," runs widen straight into eight gids
+			if (!cur.inNumber && (mask == 0x5555 || (mask == 0xaaaa && !nextIsDigit)) && cur.written + 8 <= cur.capacity)
+			{
+				__m128i const lanes = _mm_and_si128(mask == 0x5555 ? digits : _mm_srli_epi16(digits, 8), lowByte);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(cur.out + cur.written), _mm_unpacklo_epi16(lanes, none));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(cur.out + cur.written + 4), _mm_unpackhi_epi16(lanes, none));
+				cur.written += 8;
+				continue;
+			}
+			_mm_store_si128(reinterpret_cast<__m128i *>(values), digits);
+			consumeBlock(cur, mask, values, 16, nextIsDigit);
+		}
+		consumeScalar(cur, p, end);
+		return finish(cur);
+	}
+#endif
+
+#ifdef SDL_AVX2_INTRINSICS
+	SDL_TARGETING("avx2") static size_t parseAvx2(char const *p, size_t size, Uint32 *out, size_t capacity)
+	{
+		Cursor cur { out, 0, capacity, 0, false };
+		char const *end = p + size;
+		__m256i const zero = _mm256_set1_epi8('0');
+		__m256i const nine = _mm256_set1_epi8(9);
+		__m256i const lowByte = _mm256_set1_epi16(0x00ff);
+		alignas(32) Uint8 values[32];
+		for (; end - p >= 32 && cur.written < cur.capacity; p += 32)
+		{
+			__m256i const digits = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)), zero);
+			__m256i const isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, nine), digits);
+			Uint32 const mask = static_cast<Uint32>(_mm256_movemask_epi8(isDigit));
+			bool const nextIsDigit = end - p > 32 && static_cast<Uint8>(p[32] - '0') < 10;
+			endCarried(cur, mask);
+
+			// "d,d,d," runs widen straight into sixteen gids
+			if (!cur.inNumber && (mask == 0x55555555 || (mask == 0xaaaaaaaa && !nextIsDigit)) && cur.written + 16 <= cur.capacity)
+			{
+				__m256i const lanes = _mm256_and_si256(mask == 0x55555555 ? digits : _mm256_srli_epi16(digits, 8), lowByte);
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(cur.out + cur.written),
+					_mm256_cvtepu16_epi32(_mm256_castsi256_si128(lanes)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(cur.out + cur.written + 8),
+					_mm256_cvtepu16_epi32(_mm256_extracti128_si256(lanes, 1)));
+				cur.written += 16;
+				continue;
+			}
+			_mm256_store_si256(reinterpret_cast<__m256i *>(values), digits);
+			consumeBlock(cur, mask, values, 32, nextIsDigit);
+		}
+		consumeScalar(cur, p, end);
+		return finish(cur);
+	}
+#endif
+
+	// Fastest parser the build and the CPU support
+	static CsvParser best()
+	{
+#ifdef SDL_AVX2_INTRINSICS
+		if (SDL_HasAVX2())
+		{
+			return CsvParser::avx2;
+		}
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+		if (SDL_HasSSE2())
+		{
+			return CsvParser::sse2;
+		}
+#endif
+		return CsvParser::scalar;
+	}
+
+	static bool isAvailable(CsvParser parser)
+	{
+		switch (parser)
+		{
+#ifdef SDL_AVX2_INTRINSICS
+			case CsvParser::avx2: return SDL_HasAVX2();
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+			case CsvParser::sse2: return SDL_HasSSE2();
+#endif
+			case CsvParser::scalar: return true;
+			default: return false;
+		}
+	}
+
+	static char const *name(CsvParser parser)
+	{
+		switch (parser)
+		{
+			case CsvParser::sse2: return "sse2";
+			case CsvParser::avx2: return "avx2";
+			default: return "scalar";
+		}
+	}
+
+	// Writes up to capacity numbers into out, returns how many were found.
+	// Parsers the build does not have fall back to scalar.
+	static size_t parse(char const *text, size_t size, Uint32 *out, size_t capacity, CsvParser parser)
+	{
+		switch (parser)
+		{
+#ifdef SDL_AVX2_INTRINSICS
+			case CsvParser::avx2: return parseAvx2(text, size, out, capacity);
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+			case CsvParser::sse2: return parseSse2(text, size, out, capacity);
+#endif
+			default: return parseScalar(text, size, out, capacity);
+		}
+	}
+
+	static size_t parse(char const *text, size_t size, Uint32 *out, size_t capacity)
+	{
+		static CsvParser const parser = best();
+		return parse(text, size, out, capacity, parser);
+	}
+};
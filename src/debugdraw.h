@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <SDL3/SDL.h>
+#include "render.h"
+
+// Collects debug primitives during the frame and submits them grouped by
+// color, one SDL call per color and primitive kind.
+class DebugDraw
+{
+	struct Bucket
+	{
+		SDL_Color color;
+		std::vector<SDL_FRect> fills;
+		std::vector<SDL_FRect> outlines;
+		std::vector<std::vector<SDL_FPoint>> polylines;
+	};
+	std::vector<Bucket> buckets;
+
+	Bucket &bucket(SDL_Color color)
+	{
+		for (Bucket &b : buckets)
+		{
+			if (b.color.r == color.r && b.color.g == color.g && b.color.b == color.b && b.color.a == color.a)
+			{
+				return b;
+			}
+		}
+		buckets.push_back(Bucket { .color = color });
+		return buckets.back();
+	}
+
+public:
+	void fillRect(SDL_Color color, SDL_FRect const &rect)
+	{
+		bucket(color).fills.push_back(rect);
+	}
+
+	void rect(SDL_Color color, SDL_FRect const &rect)
+	{
+		bucket(color).outlines.push_back(rect);
+	}
+
+	// Lines of a cols x rows grid as two serpentine polylines, one per axis
+	void grid(SDL_Color color, float x, float y, float cellW, float cellH, int cols, int rows)
+	{
+		std::vector<SDL_FPoint> &vertical = bucket(color).polylines.emplace_back();
+		float const bottom = y + rows * cellH;
+		for (int c = 0; c <= cols; c++)
+		{
+			float const lx = x + c * cellW;
+			vertical.push_back(SDL_FPoint { lx, c % 2 ? bottom : y });
+			vertical.push_back(SDL_FPoint { lx, c % 2 ? y : bottom });
+		}
+
+		std::vector<SDL_FPoint> &horizontal = bucket(color).polylines.emplace_back();
+		float const right = x + cols * cellW;
+		for (int r = 0; r <= rows; r++)
+		{
+			float const ly = y + r * cellH;
+			horizontal.push_back(SDL_FPoint { r % 2 ? right : x, ly });
+			horizontal.push_back(SDL_FPoint { r % 2 ? x : right, ly });
+		}
+	}
+
+	void flush(RenderContext &gfx)
+	{
+		gfx.setDrawBlendMode(SDL_BLENDMODE_BLEND);
+		for (Bucket &b : buckets)
+		{
+			gfx.setDrawColor(b.color.r, b.color.g, b.color.b, b.color.a);
+			if (!b.fills.empty())
+			{
+				gfx.fillRects(b.fills.data(), static_cast<int>(b.fills.size()));
+				b.fills.clear();
+			}
+			if (!b.outlines.empty())
+			{
+				gfx.renderRects(b.outlines.data(), static_cast<int>(b.outlines.size()));
+				b.outlines.clear();
+			}
+			for (std::vector<SDL_FPoint> &line : b.polylines)
+			{
+				gfx.renderLines(line.data(), static_cast<int>(line.size()));
+			}
+			b.polylines.clear();
+		}
+	}
+};
@@ -20,18 +20,49 @@ enum class EnemyState
 	shambling, damaged, dead
 };
 
+// Buttons of one player for one simulation tick. Jump is set only on the
+// tick the key went down, the others for as long as they are held.
+enum PlayerInput : Uint8
+{
+	INPUT_LEFT = 1 << 0,
+	INPUT_RIGHT = 1 << 1,
+	INPUT_SHOOT = 1 << 2,
+	INPUT_JUMP = 1 << 3,
+	INPUT_SWITCH_WEAPON = 1 << 4,
+	INPUT_HELD = INPUT_LEFT | INPUT_RIGHT | INPUT_SHOOT,
+};
+
+enum class WeaponMode : Uint8
+{
+	bullets, hitscan
+};
+
+float const BULLET_INTERVAL = 0.1f;
+float const HITSCAN_INTERVAL = 0.025f;
+
 struct PlayerData
 {
 	PlayerState state;
 	Timer weaponTimer;
+	Uint8 input; // PlayerInput bits of the current tick
+	WeaponMode weapon;
 
-	PlayerData() : weaponTimer(0.1f)
+	PlayerData() : weaponTimer(BULLET_INTERVAL), input(0), weapon(WeaponMode::bullets)
 	{
 		state = PlayerState::idle;
 	}
 };
 
-struct LevelData {};
+struct LevelData
+{
+	Uint32 tile; // gid in the map's tileset
+	Sint16 healthPoints; // left to a breakable tile
+	bool destroyed;
+
+	LevelData() : tile(0), healthPoints(0), destroyed(false)
+	{
+	}
+};
 struct EnemyData
 {
 	EnemyState state;
@@ -73,13 +104,13 @@ struct GameObject
 	float maxSpeedX;
 	std::vector<Animation> animations;
 	int currentAnimation;
-	SDL_Texture *texture;
+	float animDebt; // animation time not stepped yet, banked by the animation LOD
+	SDL_Texture *texture; // tiles only, animated objects draw with their clip texture
 	bool dynamic;
 	bool grounded;
 	SDL_FRect collider;
 	Timer flashTimer;
 	bool shouldFlash;
-	int spriteFrame;
 
 	GameObject() : data { .level = LevelData() }, collider { 0 }, flashTimer(0.05f)
 	{
@@ -88,10 +119,10 @@ struct GameObject
 		maxSpeedX = 0;
 		position = velocity = acceleration = glm::vec2(0);
 		currentAnimation = -1;
+		animDebt = 0;
 		texture = nullptr;
 		dynamic = false;
 		grounded = false;
 		shouldFlash = false;
-		spriteFrame = 1;
 	}
 };
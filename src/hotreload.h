@@ -0,0 +1,239 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <SDL3_mixer/SDL_mixer.h>
+#include "spritesheet.h"
+#include "tilemap.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// A changed asset, decoded off the main thread and ready to be swapped in
+struct ReloadedAsset
+{
+	std::string path;
+	SDL_Surface *surface; // set for images
+	MIX_Audio *audio;     // set for sounds
+	std::unique_ptr<TileMap> map;         // the whole map again, for maps and tilesets
+	std::unique_ptr<SpriteSheet> sprites; // set for the sprite metadata
+};
+
+// Watches the asset directory tree with inotify on a background thread.
+// Changed files are debounced, then decoded on that thread; the main thread
+// collects the results at a frame boundary with takeReady().
+class AssetWatcher
+{
+	static int const DEBOUNCE_MS = 100;
+
+	SDL_Thread *thread;
+	SDL_AtomicInt running;
+	SDL_Mutex *mutex;
+	std::vector<ReloadedAsset> ready; // guarded by mutex
+	MIX_Mixer *mixer;
+	int fd;
+	std::unordered_map<int, std::string> watchDirs;
+	std::unordered_map<std::string, Uint64> pending; // path -> last change time
+	std::string mapPath, imageDir, spritesPath;
+
+	static bool hasExtension(std::string const &path, char const *ext)
+	{
+		return path.size() > SDL_strlen(ext) && path.compare(path.size() - SDL_strlen(ext), std::string::npos, ext) == 0;
+	}
+
+	static std::string normalized(std::string const &path)
+	{
+		return std::filesystem::path(path).lexically_normal().generic_string();
+	}
+
+	static int watcherThread(void *data)
+	{
+		static_cast<AssetWatcher *>(data)->watch();
+		return 0;
+	}
+
+	void decode(std::string const &path)
+	{
+		ReloadedAsset asset { path, nullptr, nullptr };
+		bool loaded = false;
+		if (hasExtension(path, ".png"))
+		{
+			asset.surface = IMG_Load(path.c_str());
+			loaded = asset.surface;
+		}
+		else if (hasExtension(path, ".wav"))
+		{
+			asset.audio = MIX_LoadAudio(mixer, path.c_str(), true);
+			loaded = asset.audio;
+		}
+		else if ((hasExtension(path, ".tmx") && normalized(path) == mapPath) || hasExtension(path, ".tsx"))
+		{
+			// Tilesets are part of the map, any of them changing parses it anew
+			asset.map = std::make_unique<TileMap>();
+			loaded = !mapPath.empty() && asset.map->load(mapPath, imageDir);
+		}
+		else if (!spritesPath.empty() && normalized(path) == spritesPath)
+		{
+			asset.sprites = std::make_unique<SpriteSheet>();
+			loaded = asset.sprites->load(spritesPath);
+		}
+		else
+		{
+			return;
+		}
+
+		if (!loaded)
+		{
+			SDL_Log("Reload: failed to decode %s: %s", path.c_str(), SDL_GetError());
+			SDL_DestroySurface(asset.surface);
+			MIX_DestroyAudio(asset.audio);
+			return;
+		}
+		SDL_LockMutex(mutex);
+		ready.push_back(std::move(asset));
+		SDL_UnlockMutex(mutex);
+	}
+
+	void watch()
+	{
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		while (SDL_GetAtomicInt(&running))
+		{
+			pollfd pfd { fd, POLLIN, 0 };
+			if (poll(&pfd, 1, DEBOUNCE_MS) > 0)
+			{
+				ssize_t const len = read(fd, buffer, sizeof(buffer));
+				for (ssize_t offset = 0; offset < len;)
+				{
+					inotify_event const *event = reinterpret_cast<inotify_event const *>(buffer + offset);
+					offset += sizeof(inotify_event) + event->len;
+					auto dir = watchDirs.find(event->wd);
+					if (event->len > 0 && dir != watchDirs.end())
+					{
+						pending[dir->second + "/" + event->name] = SDL_GetTicks();
+					}
+				}
+			}
+
+			// Editors often write a file in several steps, wait for it to settle
+			Uint64 const now = SDL_GetTicks();
+			for (auto it = pending.begin(); it != pending.end();)
+			{
+				if (now - it->second >= DEBOUNCE_MS)
+				{
+					decode(it->first);
+					it = pending.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+#endif
+	}
+
+public:
+	AssetWatcher() : thread(nullptr), running { 0 }, mutex(nullptr), mixer(nullptr), fd(-1)
+	{
+	}
+
+	~AssetWatcher()
+	{
+		stop();
+	}
+
+	// Metadata the game parsed at startup, reloaded as a whole when it changes.
+	// Set before start().
+	void setMetadata(std::string const &map, std::string const &tileImageDir, std::string const &sprites)
+	{
+		mapPath = normalized(map);
+		imageDir = tileImageDir;
+		spritesPath = normalized(sprites);
+	}
+
+	bool start(std::string const &root, MIX_Mixer *audioMixer)
+	{
+#ifdef __linux__
+		mixer = audioMixer;
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0)
+		{
+			SDL_Log("Reload: inotify unavailable");
+			return false;
+		}
+
+		// inotify is not recursive, watch every directory of the tree
+		std::vector<std::string> dirs { root };
+		std::error_code ec;
+		for (auto const &entry : std::filesystem::recursive_directory_iterator(root, ec))
+		{
+			if (entry.is_directory())
+			{
+				dirs.push_back(entry.path().generic_string());
+			}
+		}
+		for (std::string const &dir : dirs)
+		{
+			int const wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (wd >= 0)
+			{
+				watchDirs[wd] = dir;
+			}
+		}
+
+		mutex = SDL_CreateMutex();
+		SDL_SetAtomicInt(&running, 1);
+		thread = SDL_CreateThread(watcherThread, "assetwatch", this);
+		SDL_Log("Reload: watching %d directories under %s", static_cast<int>(watchDirs.size()), root.c_str());
+		return true;
+#else
+		SDL_Log("Reload: hot reload needs inotify and is only available on Linux");
+		return false;
+#endif
+	}
+
+	void stop()
+	{
+		if (!thread)
+		{
+			return;
+		}
+		SDL_SetAtomicInt(&running, 0);
+		SDL_WaitThread(thread, nullptr);
+		thread = nullptr;
+#ifdef __linux__
+		close(fd);
+#endif
+		fd = -1;
+		for (ReloadedAsset &asset : ready)
+		{
+			SDL_DestroySurface(asset.surface);
+			MIX_DestroyAudio(asset.audio);
+		}
+		ready.clear();
+		SDL_DestroyMutex(mutex);
+		mutex = nullptr;
+	}
+
+	// Moves decoded assets to the caller, who takes ownership of them
+	void takeReady(std::vector<ReloadedAsset> &out)
+	{
+		out.clear();
+		if (!thread)
+		{
+			return;
+		}
+		SDL_LockMutex(mutex);
+		out.swap(ready);
+		SDL_UnlockMutex(mutex);
+	}
+};
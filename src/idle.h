@@ -0,0 +1,110 @@
+#pragma once
+#include <ctime>
+#include <SDL3/SDL.h>
+
+// Follows window visibility and focus from window events. While nothing can
+// be seen the loop skips rendering and sleeps in SDL_WaitEventTimeout; the
+// simulation pauses too unless it is set to keep running in the background.
+// Process CPU time spent idle is logged on every resume.
+class IdleThrottle
+{
+	static Sint32 const PAUSED_WAIT_MS = 250;
+	static Sint32 const BACKGROUND_WAIT_MS = 16; // paces a simulation that keeps running
+
+	bool minimized, hidden, occluded, unfocused;
+	bool redraw;
+	bool runInBackground;
+	bool idle;
+	Uint64 idleSince;
+	std::clock_t cpuSince;
+
+	void refresh()
+	{
+		bool const wasIdle = idle;
+		idle = !isVisible() || (unfocused && !runInBackground);
+		if (idle == wasIdle)
+		{
+			return;
+		}
+		if (idle)
+		{
+			idleSince = SDL_GetTicks();
+			cpuSince = std::clock();
+		}
+		else
+		{
+			double const seconds = (SDL_GetTicks() - idleSince) / 1000.0;
+			double const cpuMs = static_cast<double>(std::clock() - cpuSince) * 1000.0 / CLOCKS_PER_SEC;
+			SDL_Log("Idle: %.1f s, %.1f ms of CPU time (%.2f%% of a core)",
+				seconds, cpuMs, seconds > 0 ? cpuMs / (seconds * 10.0) : 0.0);
+		}
+	}
+
+public:
+	IdleThrottle() : minimized(false), hidden(false), occluded(false), unfocused(false), redraw(false),
+		runInBackground(false), idle(false), idleSince(0), cpuSince(0)
+	{
+	}
+
+	// Keep simulating while hidden or unfocused, e.g. in a net session
+	void setRunInBackground(bool on)
+	{
+		runInBackground = on;
+		refresh();
+	}
+
+	bool isVisible() const { return !minimized && !hidden && !occluded; }
+
+	// Nothing to simulate, tracks and audio can be paused too
+	bool isPaused() const { return idle && !runInBackground; }
+
+	void handleEvent(SDL_Event const &event)
+	{
+		switch (event.type)
+		{
+			case SDL_EVENT_WINDOW_MINIMIZED: minimized = true; break;
+			case SDL_EVENT_WINDOW_RESTORED:
+			case SDL_EVENT_WINDOW_MAXIMIZED: minimized = false; redraw = true; break;
+			case SDL_EVENT_WINDOW_HIDDEN: hidden = true; break;
+			case SDL_EVENT_WINDOW_SHOWN: hidden = false; redraw = true; break;
+			case SDL_EVENT_WINDOW_OCCLUDED: occluded = true; break;
+			case SDL_EVENT_WINDOW_EXPOSED: occluded = false; redraw = true; break;
+			case SDL_EVENT_WINDOW_RESIZED: redraw = true; break;
+			case SDL_EVENT_WINDOW_FOCUS_LOST: unfocused = true; break;
+			case SDL_EVENT_WINDOW_FOCUS_GAINED: unfocused = false; break;
+			default: return;
+		}
+		refresh();
+	}
+
+	// Blocks until an event arrives when there is nothing to do this frame.
+	// The event stays queued for the caller to poll.
+	void wait() const
+	{
+		if (isPaused())
+		{
+			SDL_WaitEventTimeout(nullptr, PAUSED_WAIT_MS);
+		}
+		else if (!isVisible())
+		{
+			SDL_WaitEventTimeout(nullptr, BACKGROUND_WAIT_MS);
+		}
+	}
+
+	// Whether this frame should be drawn. A paused but visible window is
+	// redrawn once when it gets exposed or resized.
+	bool shouldRender()
+	{
+		if (!isVisible())
+		{
+			return false;
+		}
+		if (!isPaused())
+		{
+			return true;
+		}
+		bool const once = redraw;
+		redraw = false;
+		return once;
+	}
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <SDL3/SDL.h>
+
+// Measures input latency per key press: from the timestamp SDL gave the
+// event to the return of the SDL_RenderPresent of the first frame that
+// simulated the tick consuming it. Summaries are logged every few seconds.
+class InputLatency
+{
+	static Uint64 const PENDING = ~0ull;
+	static int const MAX_INPUTS = 64;   // key presses waiting for their present
+	static int const SAMPLES = 256;     // latencies kept for the summary
+	static Uint64 const REPORT_NS = 5000000000ull;
+
+	struct Input
+	{
+		Uint64 timestamp; // SDL_GetTicksNS time base
+		Uint64 tick;      // tick that consumed it, PENDING until then
+	};
+
+	Input inputs[MAX_INPUTS];
+	int inputCount;
+	float samples[SAMPLES]; // milliseconds
+	int sampleCount, sampleNext;
+	float average, worst;
+	Uint64 lastReport;
+	bool enabled;
+
+	void summarize()
+	{
+		float sorted[SAMPLES];
+		int const count = std::min(sampleCount, SAMPLES);
+		std::copy(samples, samples + count, sorted);
+		std::sort(sorted, sorted + count);
+		float sum = 0;
+		for (int i = 0; i < count; i++)
+		{
+			sum += sorted[i];
+		}
+		average = sum / count;
+		worst = sorted[count - 1];
+		SDL_Log("Latency: %d inputs, min %.1f ms, avg %.1f ms, p95 %.1f ms, max %.1f ms",
+			count, sorted[0], average, sorted[count * 95 / 100], worst);
+	}
+
+public:
+	InputLatency() : inputCount(0), sampleCount(0), sampleNext(0), average(0), worst(0), lastReport(0), enabled(false)
+	{
+	}
+
+	void setEnabled(bool on)
+	{
+		enabled = on;
+		lastReport = SDL_GetTicksNS();
+	}
+	bool isEnabled() const { return enabled; }
+	float getAverage() const { return average; }
+	float getWorst() const { return worst; }
+
+	// A key press polled from SDL
+	void record(Uint64 timestamp)
+	{
+		if (enabled && inputCount < MAX_INPUTS)
+		{
+			inputs[inputCount++] = Input { timestamp, PENDING };
+		}
+	}
+
+	// Pending presses are applied at this tick
+	void consume(Uint64 tick)
+	{
+		for (int i = 0; i < inputCount; i++)
+		{
+			if (inputs[i].tick == PENDING)
+			{
+				inputs[i].tick = tick;
+			}
+		}
+	}
+
+	// Call right after presenting a frame that simulated every tick before simulatedTicks
+	void presented(Uint64 simulatedTicks)
+	{
+		if (!enabled)
+		{
+			return;
+		}
+		Uint64 const now = SDL_GetTicksNS();
+		int kept = 0;
+		for (int i = 0; i < inputCount; i++)
+		{
+			Input const &input = inputs[i];
+			if (input.tick != PENDING && input.tick < simulatedTicks)
+			{
+				samples[sampleNext] = static_cast<float>(now - input.timestamp) / 1000000.0f;
+				sampleNext = (sampleNext + 1) % SAMPLES;
+				sampleCount++;
+			}
+			else
+			{
+				inputs[kept++] = input;
+			}
+		}
+		inputCount = kept;
+
+		if (sampleCount > 0 && now - lastReport >= REPORT_NS)
+		{
+			summarize();
+			sampleCount = sampleNext = 0;
+			lastReport = now;
+		}
+	}
+};
@@ -0,0 +1,355 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <SDL3/SDL.h>
+#include "snapshot.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Non-blocking UDP socket talking to a single peer. Without a peer set, the
+// sender of the first datagram received becomes the peer.
+class UdpSocket
+{
+#ifndef _WIN32
+	int fd;
+	sockaddr_in peer;
+#endif
+	bool hasPeer;
+
+public:
+#ifndef _WIN32
+	UdpSocket() : fd(-1), peer { }, hasPeer(false)
+	{
+	}
+#else
+	UdpSocket() : hasPeer(false)
+	{
+	}
+#endif
+
+	~UdpSocket()
+	{
+		close();
+	}
+
+	UdpSocket(UdpSocket const &) = delete;
+	UdpSocket &operator=(UdpSocket const &) = delete;
+
+	bool isConnected() const { return hasPeer; }
+
+	// Binds to the port on every interface, 0 picks any free port
+	bool open(Uint16 port)
+	{
+#ifndef _WIN32
+		fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fd < 0)
+		{
+			SDL_Log("Net: cannot create socket");
+			return false;
+		}
+		sockaddr_in local { };
+		local.sin_family = AF_INET;
+		local.sin_addr.s_addr = htonl(INADDR_ANY);
+		local.sin_port = htons(port);
+		if (bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) < 0 ||
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0)
+		{
+			SDL_Log("Net: cannot bind UDP port %d", port);
+			close();
+			return false;
+		}
+		return true;
+#else
+		SDL_Log("Net: UDP sessions are only available on POSIX systems");
+		return false;
+#endif
+	}
+
+	bool connect(char const *host, Uint16 port)
+	{
+#ifndef _WIN32
+		addrinfo hints { };
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo *found = nullptr;
+		if (getaddrinfo(host, nullptr, &hints, &found) != 0 || !found)
+		{
+			SDL_Log("Net: cannot resolve %s", host);
+			return false;
+		}
+		peer = *reinterpret_cast<sockaddr_in *>(found->ai_addr);
+		peer.sin_port = htons(port);
+		freeaddrinfo(found);
+		hasPeer = true;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void close()
+	{
+#ifndef _WIN32
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+		fd = -1;
+#endif
+		hasPeer = false;
+	}
+
+	void send(void const *data, size_t size)
+	{
+#ifndef _WIN32
+		if (hasPeer)
+		{
+			sendto(fd, data, size, 0, reinterpret_cast<sockaddr const *>(&peer), sizeof(peer));
+		}
+#endif
+	}
+
+	// Size of the datagram read, or -1 when none is waiting
+	int receive(void *data, size_t capacity)
+	{
+#ifndef _WIN32
+		sockaddr_in from { };
+		socklen_t fromSize = sizeof(from);
+		ssize_t const size = recvfrom(fd, data, capacity, 0, reinterpret_cast<sockaddr *>(&from), &fromSize);
+		if (size < 0)
+		{
+			return -1;
+		}
+		if (!hasPeer)
+		{
+			peer = from;
+			hasPeer = true;
+			SDL_Log("Net: peer %s:%d joined", inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+		}
+		return static_cast<int>(size);
+#else
+		return -1;
+#endif
+	}
+};
+
+// Two player rollback session over UDP. Each peer schedules its input a few
+// ticks ahead and sends every input the other side has not acknowledged yet.
+// Ticks run ahead of the remote input on a prediction (the last remote input,
+// held buttons only); when the real input turns out different, the state is
+// restored from the snapshot of that tick and the ticks since are simulated
+// again. A peer waits instead of predicting further than MAX_ROLLBACK ticks.
+class RollbackSession
+{
+public:
+	static int const MAX_ROLLBACK = 8;
+	static int const INPUT_DELAY = 2;
+
+private:
+	static int const HISTORY = 64;     // ring of inputs, covers delay, rollback and send window
+	static int const SEND_WINDOW = 32; // most inputs a packet carries
+	static int const SNAPSHOTS = MAX_ROLLBACK + 1;
+	static Uint32 const MAGIC = 0x314b4252; // "RBK1"
+
+	struct Packet
+	{
+		Uint32 magic;
+		Sint32 firstTick; // tick of inputs[0]
+		Sint32 ackTick;   // the sender has our inputs for every tick before this one
+		Uint8 count;
+		Uint8 inputs[SEND_WINDOW];
+	};
+
+	UdpSocket socket;
+	int localPlayer;
+	Uint8 heldMask;
+	int tick;         // next tick to simulate
+	int localEnd;     // local inputs are known for ticks before localEnd
+	int remoteEnd;    // remote inputs have arrived for every tick before remoteEnd
+	int remoteAcked;  // the peer has our inputs for ticks before remoteAcked
+	int mispredicted; // earliest simulated tick run on a wrong prediction, -1 if none
+	Uint8 localInputs[HISTORY];
+	Uint8 remoteInputs[HISTORY];
+	Uint8 usedRemote[HISTORY]; // remote input each simulated tick ran with
+	Snapshot snapshots[SNAPSHOTS]; // state at the start of tick t in slot t % SNAPSHOTS
+	int rollbacks, resimulated, lastDepth;
+	float rollbackTime; // moving average of the time one rollback takes, in seconds
+
+	Uint8 remoteInput(int t)
+	{
+		Uint8 const input = t < remoteEnd ? remoteInputs[t % HISTORY] : remoteInputs[(remoteEnd - 1) % HISTORY] & heldMask;
+		usedRemote[t % HISTORY] = input;
+		return input;
+	}
+
+	template <typename Step>
+	void run(int t, bool replay, Step &step)
+	{
+		Uint8 inputs[2];
+		inputs[localPlayer] = localInputs[t % HISTORY];
+		inputs[1 - localPlayer] = remoteInput(t);
+		step(inputs, replay);
+	}
+
+	void receivePacket(Packet const &packet, int size)
+	{
+		int const count = std::min<int>(packet.count, SEND_WINDOW);
+		if (size < static_cast<int>(offsetof(Packet, inputs)) + count || SDL_Swap32LE(packet.magic) != MAGIC)
+		{
+			return;
+		}
+		int const first = static_cast<Sint32>(SDL_Swap32LE(packet.firstTick));
+		remoteAcked = std::max(remoteAcked, std::min(static_cast<int>(SDL_Swap32LE(packet.ackTick)), localEnd));
+
+		// Inputs past a gap are dropped, the next packet starts at our ack again
+		int const end = std::min(first + count, tick + HISTORY - SNAPSHOTS);
+		if (first > remoteEnd)
+		{
+			return;
+		}
+		for (int t = remoteEnd; t < end; t++)
+		{
+			Uint8 const input = packet.inputs[t - first];
+			remoteInputs[t % HISTORY] = input;
+			if (t < tick && usedRemote[t % HISTORY] != input && (mispredicted < 0 || t < mispredicted))
+			{
+				mispredicted = t;
+			}
+		}
+		remoteEnd = std::max(remoteEnd, end);
+	}
+
+public:
+	RollbackSession() : localPlayer(0), heldMask(0xff), rollbacks(0), resimulated(0), lastDepth(0), rollbackTime(0)
+	{
+		reset();
+	}
+
+	bool isOpen() const { return socket.isConnected(); }
+	int getLocalPlayer() const { return localPlayer; }
+	int getTick() const { return tick; }
+	int getPredictedTicks() const { return std::max(0, tick - remoteEnd); }
+	int getRollbacks() const { return rollbacks; }
+	int getResimulatedTicks() const { return resimulated; }
+	int getLastDepth() const { return lastDepth; }
+	float getRollbackTime() const { return rollbackTime; }
+
+	// Only these buttons are assumed to stay down when predicting the remote input
+	void setHeldMask(Uint8 mask) { heldMask = mask; }
+
+	void reset()
+	{
+		SDL_memset(localInputs, 0, sizeof(localInputs));
+		SDL_memset(remoteInputs, 0, sizeof(remoteInputs));
+		SDL_memset(usedRemote, 0, sizeof(usedRemote));
+		tick = 0;
+		// Both peers start with neutral input for the delayed first ticks
+		localEnd = remoteEnd = remoteAcked = INPUT_DELAY;
+		mispredicted = -1;
+	}
+
+	// The host waits on a port for the peer to send first
+	bool host(Uint16 port)
+	{
+		localPlayer = 0;
+		reset();
+		if (!socket.open(port))
+		{
+			return false;
+		}
+		SDL_Log("Net: hosting on UDP port %d", port);
+		return true;
+	}
+
+	bool join(char const *host, Uint16 port)
+	{
+		localPlayer = 1;
+		reset();
+		return socket.open(0) && socket.connect(host, port);
+	}
+
+	// Reads every waiting packet, records where predictions were wrong
+	void receive()
+	{
+		Packet packet;
+		for (int size; (size = socket.receive(&packet, sizeof(packet))) >= 0;)
+		{
+			receivePacket(packet, size);
+		}
+	}
+
+	// Sends the inputs the peer has not acknowledged yet
+	void send()
+	{
+		Packet packet;
+		int const count = std::min(localEnd - remoteAcked, SEND_WINDOW);
+		packet.magic = SDL_Swap32LE(MAGIC);
+		packet.firstTick = static_cast<Sint32>(SDL_Swap32LE(static_cast<Uint32>(localEnd - count)));
+		packet.ackTick = static_cast<Sint32>(SDL_Swap32LE(static_cast<Uint32>(remoteEnd)));
+		packet.count = static_cast<Uint8>(count);
+		for (int i = 0; i < count; i++)
+		{
+			packet.inputs[i] = localInputs[(localEnd - count + i) % HISTORY];
+		}
+		socket.send(&packet, offsetof(Packet, inputs) + count);
+	}
+
+	// Restores the first mispredicted tick and simulates up to the current one
+	// again. Step is called as step(Uint8 const inputs[2], bool replay), restore
+	// returns false when a snapshot does not restore and the state is kept.
+	template <typename Save, typename Restore, typename Step>
+	void rollback(Save &&save, Restore &&restore, Step &&step)
+	{
+		if (mispredicted < 0)
+		{
+			return;
+		}
+		Uint64 const begin = SDL_GetPerformanceCounter();
+		if (!restore(snapshots[mispredicted % SNAPSHOTS]))
+		{
+			SDL_Log("Net: snapshot of tick %d does not restore, keeping the current state", mispredicted);
+			mispredicted = -1;
+			return;
+		}
+		for (int t = mispredicted; t < tick; t++)
+		{
+			if (t != mispredicted)
+			{
+				save(snapshots[t % SNAPSHOTS]);
+			}
+			run(t, true, step);
+		}
+		lastDepth = tick - mispredicted;
+		resimulated += lastDepth;
+		rollbacks++;
+		mispredicted = -1;
+
+		float const elapsed = static_cast<float>(SDL_GetPerformanceCounter() - begin) / SDL_GetPerformanceFrequency();
+		rollbackTime = rollbackTime == 0 ? elapsed : rollbackTime * 0.9f + elapsed * 0.1f;
+	}
+
+	// False while the remote input lags too far behind to keep predicting
+	bool canAdvance() const
+	{
+		return tick < remoteEnd + MAX_ROLLBACK;
+	}
+
+	// Schedules the local input INPUT_DELAY ticks ahead and simulates one tick
+	template <typename Save, typename Step>
+	void advance(Uint8 input, Save &&save, Step &&step)
+	{
+		localInputs[localEnd % HISTORY] = input;
+		localEnd++;
+		save(snapshots[tick % SNAPSHOTS]);
+		run(tick, false, step);
+		tick++;
+	}
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+#include "render.h"
+
+// How the particles of one burst are spawned
+struct ParticleBurst
+{
+	SDL_FColor color;
+	float angle, spread;      // radians, particles fly within angle +- spread
+	float minSpeed, maxSpeed; // pixels per second
+	float minLife, maxLife;   // seconds
+	float gravity;            // scale of the system's gravity
+};
+
+// Fixed capacity particle pool in structure of arrays layout. Slots are handed
+// out as a ring, a full pool recycles its oldest particles. Integration runs
+// over plain float arrays four lanes at a time, dead particles included, and
+// all live particles are drawn as untextured quads in a single geometry call.
+class ParticleSystem
+{
+public:
+	static int const CAPACITY = 1 << 16;
+
+private:
+	std::vector<float> x, y, vx, vy, gravity;
+	std::vector<float> life, fade; // seconds left, 1 / lifetime
+	std::vector<SDL_FColor> color;
+	int head; // next slot handed out
+	int used; // slots below this one may hold a live particle
+	float longestLife; // seconds until every particle is dead
+	Uint64 rngState;
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+	int drawn;
+
+	void integrateScalar(int begin, int end, float deltaTime, float g)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			vy[i] += gravity[i] * g * deltaTime;
+			x[i] += vx[i] * deltaTime;
+			y[i] += vy[i] * deltaTime;
+			life[i] -= deltaTime;
+		}
+	}
+
+#ifdef SDL_SSE2_INTRINSICS
+	void integrateSse2(int count, float deltaTime, float g)
+	{
+		__m128 const dt = _mm_set1_ps(deltaTime);
+		__m128 const gdt = _mm_set1_ps(g * deltaTime);
+		float *px = x.data(), *py = y.data(), *pvx = vx.data(), *pvy = vy.data(), *pl = life.data();
+		float const *pg = gravity.data();
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 const velY = _mm_add_ps(_mm_loadu_ps(pvy + i), _mm_mul_ps(_mm_loadu_ps(pg + i), gdt));
+			_mm_storeu_ps(pvy + i, velY);
+			_mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(_mm_loadu_ps(pvx + i), dt)));
+			_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(velY, dt)));
+			_mm_storeu_ps(pl + i, _mm_sub_ps(_mm_loadu_ps(pl + i), dt));
+		}
+		integrateScalar(i, count, deltaTime, g);
+	}
+#endif
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * SDL_randf_r(&rngState);
+	}
+
+public:
+	ParticleSystem() : head(0), used(0), longestLife(0), rngState(SDL_GetPerformanceCounter()), drawn(0)
+	{
+		for (std::vector<float> *array : { &x, &y, &vx, &vy, &gravity, &life, &fade })
+		{
+			array->assign(CAPACITY, 0.0f);
+		}
+		color.assign(CAPACITY, SDL_FColor { 1.0f, 1.0f, 1.0f, 1.0f });
+
+		// Quads never change their index pattern, build it once
+		vertices.resize(static_cast<size_t>(CAPACITY) * 4);
+		indices.resize(static_cast<size_t>(CAPACITY) * 6);
+		for (int q = 0; q < CAPACITY; q++)
+		{
+			int const base = q * 4;
+			int const quad[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+			std::copy(std::begin(quad), std::end(quad), indices.begin() + q * 6);
+		}
+	}
+
+	// Slots in use, dead or alive
+	int getUsed() const { return used; }
+	// Particles in the last draw
+	int getDrawn() const { return drawn; }
+
+	void clear()
+	{
+		head = used = 0;
+		longestLife = 0;
+	}
+
+	void emit(ParticleBurst const &burst, glm::vec2 pos, int count)
+	{
+		for (int n = 0; n < count; n++)
+		{
+			int const i = head;
+			head = (head + 1) & (CAPACITY - 1);
+			used = std::max(used, i + 1);
+
+			float const angle = burst.angle + random(-burst.spread, burst.spread);
+			float const speed = random(burst.minSpeed, burst.maxSpeed);
+			float const lifetime = random(burst.minLife, burst.maxLife);
+			x[i] = pos.x;
+			y[i] = pos.y;
+			vx[i] = SDL_cosf(angle) * speed;
+			vy[i] = SDL_sinf(angle) * speed;
+			gravity[i] = burst.gravity;
+			life[i] = lifetime;
+			fade[i] = 1.0f / lifetime;
+			color[i] = burst.color;
+			longestLife = std::max(longestLife, lifetime);
+		}
+	}
+
+	void update(float deltaTime, float g, bool simd = true)
+	{
+		if (used == 0)
+		{
+			return;
+		}
+		longestLife -= deltaTime;
+		if (longestLife <= 0)
+		{
+			clear(); // all dead, the ring starts over from the first slot
+			return;
+		}
+#ifdef SDL_SSE2_INTRINSICS
+		static bool const hasSse2 = SDL_HasSSE2();
+		if (simd && hasSse2)
+		{
+			integrateSse2(used, deltaTime, g);
+			return;
+		}
+#endif
+		integrateScalar(0, used, deltaTime, g);
+	}
+
+	// Live particles inside the view as size x size quads, alpha fading with age
+	void draw(RenderContext &gfx, SDL_FRect const &view, float size)
+	{
+		drawn = 0;
+		float const half = size / 2;
+		for (int i = 0; i < used; i++)
+		{
+			float const px = x[i] - view.x;
+			float const py = y[i] - view.y;
+			if (life[i] <= 0 || px < -half || py < -half || px > view.w + half || py > view.h + half)
+			{
+				continue;
+			}
+			SDL_FColor c = color[i];
+			c.a *= life[i] * fade[i];
+			SDL_Vertex *v = &vertices[static_cast<size_t>(drawn) * 4];
+			v[0] = SDL_Vertex { { px - half, py - half }, c, { 0, 0 } };
+			v[1] = SDL_Vertex { { px + half, py - half }, c, { 0, 0 } };
+			v[2] = SDL_Vertex { { px + half, py + half }, c, { 0, 0 } };
+			v[3] = SDL_Vertex { { px - half, py + half }, c, { 0, 0 } };
+			drawn++;
+		}
+		if (drawn > 0)
+		{
+			gfx.setDrawBlendMode(SDL_BLENDMODE_BLEND);
+			gfx.renderGeometry(nullptr, vertices.data(), drawn * 4, indices.data(), drawn * 6);
+		}
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <SDL3/SDL.h>
+
+// Degradation steps, each level includes all the ones before it
+enum class QualityLevel
+{
+	full,
+	noParallax,
+	noDebugOverlay,
+	cappedEffects,
+	reducedAnimation,
+	lowResolution,
+};
+
+// Watches frame work time (excluding the vsync wait) against a budget and
+// steps quality down when it runs over, back up when there is headroom.
+class QualityGovernor
+{
+	float budget;        // seconds of work allowed per frame
+	float smoothed;      // exponential moving average of work time
+	int overFrames, underFrames;
+	QualityLevel level;
+	bool enabled;
+
+	static int const DEGRADE_FRAMES = 30;  // sustained overrun before stepping down
+	static int const RESTORE_FRAMES = 180; // sustained headroom before stepping up
+	static constexpr float RESTORE_RATIO = 0.6f;
+
+	void setLevel(QualityLevel newLevel)
+	{
+		SDL_Log("Quality: %s -> %s (work %.2f ms, budget %.2f ms)",
+			levelName(level), levelName(newLevel), smoothed * 1000.0f, budget * 1000.0f);
+		level = newLevel;
+		overFrames = underFrames = 0;
+	}
+
+public:
+	QualityGovernor() : budget(1.0f / 60.0f), smoothed(0), overFrames(0), underFrames(0),
+		level(QualityLevel::full), enabled(true)
+	{
+	}
+
+	void setBudget(float seconds) { budget = seconds; }
+	void setEnabled(bool on)
+	{
+		enabled = on;
+		if (!enabled && level != QualityLevel::full)
+		{
+			setLevel(QualityLevel::full);
+		}
+	}
+	bool isEnabled() const { return enabled; }
+
+	QualityLevel getLevel() const { return level; }
+	float getWorkTime() const { return smoothed; }
+	bool atLeast(QualityLevel l) const { return level >= l; }
+
+	static char const *levelName(QualityLevel l)
+	{
+		switch (l)
+		{
+			case QualityLevel::full: return "full";
+			case QualityLevel::noParallax: return "no parallax";
+			case QualityLevel::noDebugOverlay: return "no debug overlay";
+			case QualityLevel::cappedEffects: return "capped effects";
+			case QualityLevel::reducedAnimation: return "reduced animation";
+			case QualityLevel::lowResolution: return "low resolution";
+		}
+		return "?";
+	}
+
+	// Feed the work time of the last frame, returns true if the level changed
+	bool update(float workTime)
+	{
+		smoothed = smoothed == 0 ? workTime : smoothed * 0.9f + workTime * 0.1f;
+		if (!enabled)
+		{
+			return false;
+		}
+
+		if (smoothed > budget)
+		{
+			underFrames = 0;
+			if (++overFrames >= DEGRADE_FRAMES && level != QualityLevel::lowResolution)
+			{
+				setLevel(static_cast<QualityLevel>(static_cast<int>(level) + 1));
+				return true;
+			}
+		}
+		else if (smoothed < budget * RESTORE_RATIO)
+		{
+			overFrames = 0;
+			if (++underFrames >= RESTORE_FRAMES && level != QualityLevel::full)
+			{
+				setLevel(static_cast<QualityLevel>(static_cast<int>(level) - 1));
+				return true;
+			}
+		}
+		else
+		{
+			overFrames = underFrames = 0;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+// Distance along the ray to where it enters the rectangle, negative when it
+// misses within maxT. A ray starting inside hits at 0. Slab test, dir need not
+// be normalized, t is in units of dir.
+inline float rayRect(glm::vec2 origin, glm::vec2 dir, SDL_FRect const &rect, float maxT)
+{
+	float tMin = 0, tMax = maxT;
+	float const lo[] = { rect.x, rect.y };
+	float const hi[] = { rect.x + rect.w, rect.y + rect.h };
+	float const o[] = { origin.x, origin.y };
+	float const d[] = { dir.x, dir.y };
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (d[axis] == 0)
+		{
+			if (o[axis] < lo[axis] || o[axis] > hi[axis])
+			{
+				return -1;
+			}
+			continue;
+		}
+		float t0 = (lo[axis] - o[axis]) / d[axis];
+		float t1 = (hi[axis] - o[axis]) / d[axis];
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+		tMin = std::max(tMin, t0);
+		tMax = std::min(tMax, t1);
+		if (tMin > tMax)
+		{
+			return -1;
+		}
+	}
+	return tMin;
+}
+
+// Walks the cells of a cols x rows grid of square cells crossed by a ray, in
+// order, with the incremental traversal of Amanatides and Woo: per step one
+// compare picks the axis whose next cell boundary is closer. Origin is
+// relative to the grid corner. visit(col, row, tEnter, tExit) returns false to
+// stop early; the walk also ends at maxT or when the ray leaves the grid.
+template <typename Visit>
+void traverseGrid(glm::vec2 origin, glm::vec2 dir, float maxT, float cellSize, int cols, int rows, Visit &&visit)
+{
+	float const inf = std::numeric_limits<float>::infinity();
+
+	// Clip the ray to the grid so it may start outside of it
+	float const tStart = rayRect(origin, dir, SDL_FRect { 0, 0, cols * cellSize, rows * cellSize }, maxT);
+	if (tStart < 0)
+	{
+		return;
+	}
+	glm::vec2 const entry = origin + dir * tStart;
+	int col = std::clamp(static_cast<int>(SDL_floorf(entry.x / cellSize)), 0, cols - 1);
+	int row = std::clamp(static_cast<int>(SDL_floorf(entry.y / cellSize)), 0, rows - 1);
+
+	int const stepCol = dir.x > 0 ? 1 : -1;
+	int const stepRow = dir.y > 0 ? 1 : -1;
+	// Ray distance between two boundaries of an axis, and to the next boundary
+	float const deltaX = dir.x != 0 ? cellSize / SDL_fabsf(dir.x) : inf;
+	float const deltaY = dir.y != 0 ? cellSize / SDL_fabsf(dir.y) : inf;
+	float nextX = dir.x != 0 ? ((col + (dir.x > 0)) * cellSize - origin.x) / dir.x : inf;
+	float nextY = dir.y != 0 ? ((row + (dir.y > 0)) * cellSize - origin.y) / dir.y : inf;
+
+	float t = tStart;
+	while (t <= maxT)
+	{
+		float const tExit = std::min({ nextX, nextY, maxT });
+		if (!visit(col, row, t, tExit))
+		{
+			return;
+		}
+		t = tExit;
+		if (nextX < nextY)
+		{
+			col += stepCol;
+			nextX += deltaX;
+		}
+		else
+		{
+			row += stepRow;
+			nextY += deltaY;
+		}
+		if (col < 0 || col >= cols || row < 0 || row >= rows || t >= maxT)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <SDL3/SDL.h>
+
+struct RenderStats
+{
+	int drawCalls;
+	int stateChanges;
+	int skippedChanges;
+	int primitives;
+
+	RenderStats() : drawCalls(0), stateChanges(0), skippedChanges(0), primitives(0)
+	{
+	}
+};
+
+// Thin wrapper over SDL_Renderer that remembers the state it last set and
+// drops redundant state calls, while counting what actually reaches SDL.
+class RenderContext
+{
+	SDL_Renderer *renderer;
+	SDL_Texture *target;
+	SDL_Color drawColor;
+	SDL_BlendMode blendMode;
+	bool drawColorValid, blendModeValid;
+	RenderStats current, previous;
+
+public:
+	RenderContext() : renderer(nullptr), target(nullptr), drawColor { 0 }, blendMode(SDL_BLENDMODE_NONE)
+	{
+		drawColorValid = blendModeValid = false;
+	}
+
+	void setRenderer(SDL_Renderer *r)
+	{
+		renderer = r;
+		invalidate();
+	}
+
+	SDL_Renderer *sdl() const { return renderer; }
+	SDL_Texture *getTarget() const { return target; }
+
+	// Stats of the last completed frame, stable while the current one is drawn
+	RenderStats const &stats() const { return previous; }
+	// Stats of the frame being drawn, so far
+	RenderStats const &frameStats() const { return current; }
+
+	void beginFrame()
+	{
+		previous = current;
+		current = RenderStats();
+	}
+
+	// Forget cached renderer state, e.g. after a render target switch
+	void invalidate()
+	{
+		drawColorValid = blendModeValid = false;
+	}
+
+	void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+	{
+		if (drawColorValid && drawColor.r == r && drawColor.g == g && drawColor.b == b && drawColor.a == a)
+		{
+			current.skippedChanges++;
+			return;
+		}
+		SDL_SetRenderDrawColor(renderer, r, g, b, a);
+		drawColor = SDL_Color { r, g, b, a };
+		drawColorValid = true;
+		current.stateChanges++;
+	}
+
+	void setDrawBlendMode(SDL_BlendMode mode)
+	{
+		if (blendModeValid && blendMode == mode)
+		{
+			current.skippedChanges++;
+			return;
+		}
+		SDL_SetRenderDrawBlendMode(renderer, mode);
+		blendMode = mode;
+		blendModeValid = true;
+		current.stateChanges++;
+	}
+
+	// Redirect drawing to a texture, or back to the window with nullptr
+	void setTarget(SDL_Texture *tex)
+	{
+		SDL_SetRenderTarget(renderer, tex);
+		target = tex;
+		invalidate();
+		current.stateChanges++;
+	}
+
+	void setScale(float scale)
+	{
+		SDL_SetRenderScale(renderer, scale, scale);
+		current.stateChanges++;
+	}
+
+	void clear()
+	{
+		SDL_RenderClear(renderer);
+		current.drawCalls++;
+	}
+
+	void renderTexture(SDL_Texture *tex, SDL_FRect const *src, SDL_FRect const *dst)
+	{
+		SDL_RenderTexture(renderer, tex, src, dst);
+		current.drawCalls++;
+		current.primitives++;
+	}
+
+	void renderTextureRotated(SDL_Texture *tex, SDL_FRect const *src, SDL_FRect const *dst, SDL_FlipMode flip)
+	{
+		SDL_RenderTextureRotated(renderer, tex, src, dst, 0, nullptr, flip);
+		current.drawCalls++;
+		current.primitives++;
+	}
+
+	void renderTextureTiled(SDL_Texture *tex, SDL_FRect const *src, float scale, SDL_FRect const *dst)
+	{
+		SDL_RenderTextureTiled(renderer, tex, src, scale, dst);
+		current.drawCalls++;
+
+		// SDL emits one quad per visible tile
+		float const tileW = (src ? src->w : tex->w) * scale;
+		float const tileH = (src ? src->h : tex->h) * scale;
+		current.primitives += static_cast<int>(SDL_ceilf(dst->w / tileW) * SDL_ceilf(dst->h / tileH));
+	}
+
+	void renderGeometry(SDL_Texture *tex, SDL_Vertex const *vertices, int numVertices, int const *indices, int numIndices)
+	{
+		SDL_RenderGeometry(renderer, tex, vertices, numVertices, indices, numIndices);
+		current.drawCalls++;
+		current.primitives += (indices ? numIndices : numVertices) / 3;
+	}
+
+	void fillRect(SDL_FRect const &rect)
+	{
+		SDL_RenderFillRect(renderer, &rect);
+		current.drawCalls++;
+		current.primitives++;
+	}
+
+	void fillRects(SDL_FRect const *rects, int count)
+	{
+		SDL_RenderFillRects(renderer, rects, count);
+		current.drawCalls++;
+		current.primitives += count;
+	}
+
+	void renderRects(SDL_FRect const *rects, int count)
+	{
+		SDL_RenderRects(renderer, rects, count);
+		current.drawCalls++;
+		current.primitives += count;
+	}
+
+	void renderLines(SDL_FPoint const *points, int count)
+	{
+		SDL_RenderLines(renderer, points, count);
+		current.drawCalls++;
+		current.primitives += count - 1;
+	}
+
+	void debugText(float x, float y, char const *text)
+	{
+		SDL_RenderDebugText(renderer, x, y, text);
+		current.drawCalls++;
+		current.primitives += static_cast<int>(SDL_strlen(text));
+	}
+
+	void present()
+	{
+		SDL_RenderPresent(renderer);
+	}
+};
@@ -0,0 +1,249 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <SDL3_mixer/SDL_mixer.h>
+
+// Path-keyed cache of textures and decoded audio. Loading the same path twice
+// returns the same object with its reference count raised. Entries nobody
+// references stay cached until the byte budget is exceeded, then the least
+// recently used ones are destroyed first.
+class ResourceCache
+{
+	enum class Kind
+	{
+		texture, audio
+	};
+
+	struct Entry
+	{
+		Kind kind;
+		SDL_Texture *texture;
+		MIX_Audio *audio;
+		size_t bytes;
+		int refs;
+		Uint64 lastUse;
+	};
+
+	std::unordered_map<std::string, Entry> entries;
+	std::unordered_map<void const *, std::string> paths; // object -> path
+	size_t budget;
+	size_t textureBytes, audioBytes;
+	Uint64 useClock;
+	int evictions;
+
+	static size_t textureSize(SDL_Texture const *tex)
+	{
+		return static_cast<size_t>(tex->w) * tex->h * SDL_BYTESPERPIXEL(tex->format);
+	}
+
+	static size_t audioSize(MIX_Audio *audio)
+	{
+		SDL_AudioSpec spec { };
+		if (!MIX_GetAudioFormat(audio, &spec))
+		{
+			return 0;
+		}
+		Sint64 const frames = MIX_GetAudioDuration(audio);
+		return frames > 0 ? static_cast<size_t>(frames) * spec.channels * SDL_AUDIO_BYTESIZE(spec.format) : 0;
+	}
+
+	void account(Entry const &entry, bool add)
+	{
+		size_t &total = entry.kind == Kind::texture ? textureBytes : audioBytes;
+		total = add ? total + entry.bytes : total - entry.bytes;
+	}
+
+	void destroy(Entry &entry)
+	{
+		account(entry, false);
+		if (entry.kind == Kind::texture)
+		{
+			paths.erase(entry.texture);
+			SDL_DestroyTexture(entry.texture);
+		}
+		else
+		{
+			paths.erase(entry.audio);
+			MIX_DestroyAudio(entry.audio);
+		}
+	}
+
+	Entry *find(std::string const &path)
+	{
+		auto it = entries.find(path);
+		return it != entries.end() ? &it->second : nullptr;
+	}
+
+	void release(void const *object)
+	{
+		auto it = paths.find(object);
+		if (it == paths.end())
+		{
+			return;
+		}
+		Entry &entry = entries[it->second];
+		if (entry.refs > 0)
+		{
+			entry.refs--;
+		}
+		evict();
+	}
+
+	void insert(std::string const &path, Entry const &entry)
+	{
+		entries[path] = entry;
+		paths[entry.kind == Kind::texture ? static_cast<void const *>(entry.texture) : entry.audio] = path;
+		account(entry, true);
+		evict();
+	}
+
+public:
+	ResourceCache() : budget(256 * 1024 * 1024), textureBytes(0), audioBytes(0), useClock(0), evictions(0)
+	{
+	}
+
+	void setBudget(size_t bytes)
+	{
+		budget = bytes;
+		evict();
+	}
+
+	size_t getBudget() const { return budget; }
+	size_t getTextureBytes() const { return textureBytes; }
+	size_t getAudioBytes() const { return audioBytes; }
+	size_t getTotalBytes() const { return textureBytes + audioBytes; }
+	int getEntryCount() const { return static_cast<int>(entries.size()); }
+	int getEvictions() const { return evictions; }
+
+	// A surface decoded ahead of time can be passed in, it stays owned by the caller
+	SDL_Texture *acquireTexture(SDL_Renderer *renderer, std::string const &path, SDL_Surface *decoded = nullptr)
+	{
+		if (Entry *entry = find(path))
+		{
+			entry->refs++;
+			entry->lastUse = ++useClock;
+			return entry->texture;
+		}
+
+		SDL_Texture *tex = decoded
+			? SDL_CreateTextureFromSurface(renderer, decoded)
+			: IMG_LoadTexture(renderer, path.c_str());
+		if (!tex)
+		{
+			SDL_Log("Cache: failed to load %s: %s", path.c_str(), SDL_GetError());
+			return nullptr;
+		}
+		SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
+		insert(path, Entry { Kind::texture, tex, nullptr, textureSize(tex), 1, ++useClock });
+		return tex;
+	}
+
+	// Audio decoded ahead of time can be passed in, the cache takes ownership of it
+	MIX_Audio *acquireAudio(MIX_Mixer *mixer, std::string const &path, MIX_Audio *decoded = nullptr)
+	{
+		if (Entry *entry = find(path))
+		{
+			MIX_DestroyAudio(decoded);
+			entry->refs++;
+			entry->lastUse = ++useClock;
+			return entry->audio;
+		}
+
+		MIX_Audio *audio = decoded ? decoded : MIX_LoadAudio(mixer, path.c_str(), true);
+		if (!audio)
+		{
+			SDL_Log("Cache: failed to load %s: %s", path.c_str(), SDL_GetError());
+			return nullptr;
+		}
+		insert(path, Entry { Kind::audio, nullptr, audio, audioSize(audio), 1, ++useClock });
+		return audio;
+	}
+
+	void releaseTexture(SDL_Texture *tex) { release(tex); }
+	void releaseAudio(MIX_Audio *audio) { release(audio); }
+
+	// Lookup without taking a reference
+	SDL_Texture *findTexture(std::string const &path)
+	{
+		Entry *entry = find(path);
+		return entry && entry->kind == Kind::texture ? entry->texture : nullptr;
+	}
+
+	MIX_Audio *findAudio(std::string const &path)
+	{
+		Entry *entry = find(path);
+		return entry && entry->kind == Kind::audio ? entry->audio : nullptr;
+	}
+
+	// Swap the object cached for a path, references carry over. The caller
+	// repoints its holders and destroys the previous object. False when the
+	// path is not cached as that kind, nothing changes then.
+	bool replaceTexture(std::string const &path, SDL_Texture *tex)
+	{
+		Entry *entry = find(path);
+		if (!entry || entry->kind != Kind::texture)
+		{
+			return false;
+		}
+		account(*entry, false);
+		paths.erase(entry->texture);
+		entry->texture = tex;
+		entry->bytes = textureSize(tex);
+		paths[tex] = path;
+		account(*entry, true);
+		evict();
+		return true;
+	}
+
+	bool replaceAudio(std::string const &path, MIX_Audio *audio)
+	{
+		Entry *entry = find(path);
+		if (!entry || entry->kind != Kind::audio)
+		{
+			return false;
+		}
+		account(*entry, false);
+		paths.erase(entry->audio);
+		entry->audio = audio;
+		entry->bytes = audioSize(audio);
+		paths[audio] = path;
+		account(*entry, true);
+		evict();
+		return true;
+	}
+
+	// Destroy least recently used unreferenced entries until within budget
+	void evict()
+	{
+		while (getTotalBytes() > budget)
+		{
+			auto victim = entries.end();
+			for (auto it = entries.begin(); it != entries.end(); ++it)
+			{
+				if (it->second.refs == 0 && (victim == entries.end() || it->second.lastUse < victim->second.lastUse))
+				{
+					victim = it;
+				}
+			}
+			if (victim == entries.end())
+			{
+				break; // everything left is in use
+			}
+			destroy(victim->second);
+			entries.erase(victim);
+			evictions++;
+		}
+	}
+
+	void clear()
+	{
+		for (auto &entry : entries)
+		{
+			destroy(entry.second);
+		}
+		entries.clear();
+		paths.clear();
+	}
+};
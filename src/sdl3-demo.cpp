@@ -2,13 +2,33 @@
 #include <SDL3/SDL_main.h>
 #include <SDL3_image/SDL_image.h>
 #include <SDL3_mixer/SDL_mixer.h>
+#include <algorithm>
 #include <array>
 #include <format>
 #include <glm/ext/vector_float2.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "background.h"
+#include "capture.h"
+#include "camera.h"
+#include "debugdraw.h"
 #include "gameobject.h"
+#include "hotreload.h"
+#include "idle.h"
+#include "latency.h"
+#include "netplay.h"
+#include "particles.h"
+#include "quality.h"
+#include "raycast.h"
+#include "resourcecache.h"
+#include "render.h"
+#include "snapshot.h"
+#include "spatialgrid.h"
+#include "spritebatch.h"
+#include "startup.h"
+#include "tilemap.h"
 
 using namespace std;
 
@@ -17,21 +37,80 @@ struct SDLState
 	SDL_Window *window;
 	SDL_Renderer *renderer;
 	MIX_Mixer *mixer;
+	RenderContext gfx;
+	SpriteBatch batch;
+	DebugDraw debug;
+	SDL_Texture *sceneTarget;
+	SDL_FRect sceneRect; // where the scene was last blitted in the window
+	float sceneScale;
+	QualityGovernor quality;
+	FrameCapture capture;
+	StartupProfiler startup;
+	IdleThrottle idle;
+	InputLatency latency;
 	int width, height, logW, logH;
 	bool const *keys;
+	Uint8 pressedButtons; // edge triggered PlayerInput bits latched from key events
+	float frameInterval;  // seconds between two vblanks of the window's display
+	bool lateInput;       // poll input just ahead of the next vblank instead of right after present
 	bool fullscreen;
+	bool integerScale;
 
 	SDLState() : keys(SDL_GetKeyboardState(nullptr))
 	{
+		mixer = nullptr;
+		sceneTarget = nullptr;
+		sceneRect = SDL_FRect { 0 };
+		sceneScale = 1;
+		pressedButtons = 0;
+		frameInterval = 1.0f / 60.0f;
+		lateInput = false;
 		fullscreen = false;
+		integerScale = true;
 	}
 };
 
 size_t const LAYER_IDX_LEVEL = 0;
 size_t const LAYER_IDX_CHARACTERS = 1;
-int const MAP_ROWS = 5;
-int const MAP_COLS = 46;
 int const TILE_SIZE = 32;
+int const GRID_CELL_SIZE = TILE_SIZE * 2;
+int const CHUNK_SIZE = TILE_SIZE * 8;
+float const SFX_GAIN = 0.5f;
+int const MAX_BULLETS_CAPPED = 24;
+float const GRAVITY = 500.0f;
+float const ANIM_LOD_DISTANCE = 200.0f;
+float const ANIM_LOD_INTERVAL = 1.0f / 12.0f;
+float const NET_TICK = 1.0f / 60.0f;
+float const LATE_INPUT_MARGIN = 0.002f;
+float const PARTICLE_SIZE = 2.0f;
+float const HITSCAN_RANGE = 400.0f;
+float const TRACER_SPACING = 6.0f;
+Sint16 const TILE_HEALTH = 30;
+Sint16 const SHOT_DAMAGE = 10;
+ParticleBurst const BURST_SPARKS { { 1.0f, 0.85f, 0.4f, 1.0f }, 0, SDL_PI_F / 2, 40, 140, 0.15f, 0.4f, 0.5f };
+ParticleBurst const BURST_ENEMY_HIT { { 0.6f, 0.9f, 0.3f, 1.0f }, 0, SDL_PI_F / 3, 30, 110, 0.2f, 0.5f, 1.0f };
+ParticleBurst const BURST_ENEMY_DEATH { { 0.5f, 0.8f, 0.25f, 1.0f }, -SDL_PI_F / 2, SDL_PI_F, 20, 160, 0.4f, 1.0f, 1.0f };
+ParticleBurst const BURST_DEBRIS { { 0.55f, 0.55f, 0.6f, 1.0f }, -SDL_PI_F / 2, SDL_PI_F, 30, 150, 0.4f, 0.9f, 1.0f };
+ParticleBurst const BURST_TRACER { { 1.0f, 1.0f, 0.8f, 0.8f }, 0, 0, 0, 0, 0.06f, 0.06f, 0 };
+Uint64 const NET_SEED = 0x5eed5eed5eedull;
+
+// Passes of drawScene in drawing order
+enum class ScenePass
+{
+	background, backgroundTiles, objects, bullets, particles, foreground, count
+};
+char const *const SCENE_PASS_NAMES[] = { "background", "background_tiles", "objects", "bullets", "particles", "foreground" };
+
+// Time and draw calls per scene pass, summed over the frames profiled
+struct ScenePassStats
+{
+	double ms[static_cast<int>(ScenePass::count)];
+	int drawCalls[static_cast<int>(ScenePass::count)];
+
+	ScenePassStats() : ms { }, drawCalls { }
+	{
+	}
+};
 
 struct GameState
 {
@@ -39,1021 +118,3246 @@ struct GameState
 	std::vector<GameObject> backgroundTiles;
 	std::vector<GameObject> foregroundTiles;
 	std::vector<GameObject> bullets;
+	SpatialGrid levelGrid; // level tiles, rebuilt only when the level layer changes
+	SpatialGrid grid;      // characters, rebuilt every tick
+	bool levelGridValid;   // levelGrid and the tile tables below match the level layer
+	std::vector<Uint8> solidTiles; // per map cell, set where a tile stops shots
+	std::vector<int> tileIndex;    // per map cell, level layer index of its tile or -1
+	std::vector<Uint8> tileLive;   // per level tile, whether the derived data holds it
+	std::vector<int> dirtyTiles;   // level tiles changed since the last commit
+	int tileCols, tileRows;
+	std::vector<GameObject> spawns; // characters as the level starts, see restart()
+	int spawnPlayerIndex, spawnRivalIndex; // player and rival within spawns
+	std::vector<ObjectRef> candidates;
+	ParticleSystem particles; // visual only, left out of snapshots
 	int playerIndex;
-	SDL_FRect mapViewport;
+	int rivalIndex; // second player of a net session, -1 otherwise
+	Camera camera;
+	SDL_FRect mapBounds;
+	SDL_Rect activeChunks; // chunk coordinates of the simulated region
 	float bg2Scroll, bg3Scroll, bg4Scroll;
+	Uint64 rngState;
 	bool debugMode;
+	bool silent; // replaying ticks whose sounds and particles were already played
 
-	GameState(SDLState const &state)
+	GameState(SDLState const &state, TileMap const &map) : camera(static_cast<float>(state.logW), static_cast<float>(state.logH))
 	{
 		playerIndex = -1;
-		mapViewport = SDL_FRect {
+		rivalIndex = -1;
+		spawnPlayerIndex = -1;
+		spawnRivalIndex = -1;
+		camera.setDeadzone(TILE_SIZE * 2, TILE_SIZE * 3);
+		activeChunks = SDL_Rect { 0 };
+		bg2Scroll = bg3Scroll = bg4Scroll = 0;
+		rngState = SDL_GetPerformanceCounter();
+		debugMode = false;
+		silent = false;
+		setMap(map);
+	}
+
+	// Bounds and grids sized for a map, the level lists are filled by createTiles
+	void setMap(TileMap const &map)
+	{
+		mapBounds = SDL_FRect {
 			.x = 0,
 			.y = 0,
-			.w = static_cast<float>(state.logW),
-			.h = static_cast<float>(state.logW),
+			.w = map.getPixelWidth(),
+			.h = map.getPixelHeight(),
 		};
-		bg2Scroll = bg3Scroll = bg4Scroll = 0;
-		debugMode = false;
+		camera.setBounds(mapBounds);
+		levelGrid.resize(mapBounds.x, mapBounds.y, mapBounds.w, mapBounds.h, GRID_CELL_SIZE);
+		grid.resize(mapBounds.x, mapBounds.y, mapBounds.w, mapBounds.h, GRID_CELL_SIZE);
+		levelGridValid = false;
+		tileCols = map.width;
+		tileRows = map.height;
 	}
 
 	GameObject &player() { return layers[LAYER_IDX_CHARACTERS][playerIndex]; }
-};
+	GameObject &rival() { return layers[LAYER_IDX_CHARACTERS][rivalIndex]; }
 
-struct Resources
-{
-	int const ANIM_PLAYER_IDLE = 0;
-	int const ANIM_PLAYER_RUN = 1;
-	int const ANIM_PLAYER_SLIDE = 2;
-	int const ANIM_PLAYER_SHOOT = 3;
-	int const ANIM_PLAYER_SLIDE_SHOOT = 4;
-	std::vector<Animation> playerAnims;
-	int const ANIM_BULLET_MOVING = 0;
-	int const ANIM_BULLET_HIT = 1;
-	std::vector<Animation> bulletAnims;
-	int const ANIM_ENEMY = 0;
-	int const ANIM_ENEMY_HIT = 1;
-	int const ANIM_ENEMY_DIE = 2;
-	std::vector<Animation> enemyAnims;
+	GameObject &nearestPlayer(glm::vec2 pos)
+	{
+		if (rivalIndex != -1 && glm::length(rival().position - pos) < glm::length(player().position - pos))
+		{
+			return rival();
+		}
+		return player();
+	}
 
-	std::vector<SDL_Texture *> textures;
-	SDL_Texture *texIdle, *texRun, *texBrick, *texGrass, *texGround, *texPanel,
-		*texSlide, *texBg1, *texBg2, *texBg3, *texBg4, *texBullet, *texBulletHit,
-		*texShoot, *texRunShoot, *texSlideShoot, *texEnemy, *texEnemyHit, *texEnemyDie;
-	
-	std::vector<MIX_Track*> tracks;
-	MIX_Track *trackShoot, *trackShootHit, *trackEnemyHit;
-	MIX_Track *trackMusic;
+	// Point the camera keeps in view, between both players in a net session
+	glm::vec2 focus()
+	{
+		glm::vec2 const center = player().position + glm::vec2(TILE_SIZE / 2);
+		return rivalIndex != -1 ? (center + rival().position + glm::vec2(TILE_SIZE / 2)) / 2.0f : center;
+	}
 
-	SDL_Texture *loadTextures(SDL_Renderer *renderer, std::string const &filepath)
+	// Chunks overlapping the camera view plus a one chunk margin are simulated
+	void updateActiveChunks()
 	{
-		SDL_Texture *tex = IMG_LoadTexture(renderer, filepath.c_str());
-		SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
-		textures.push_back(tex);
-		return tex;
+		SDL_FRect const view = camera.view();
+		int const c0 = static_cast<int>(SDL_floorf((view.x - mapBounds.x) / CHUNK_SIZE)) - 1;
+		int const r0 = static_cast<int>(SDL_floorf((view.y - mapBounds.y) / CHUNK_SIZE)) - 1;
+		int const c1 = static_cast<int>(SDL_floorf((view.x + view.w - mapBounds.x) / CHUNK_SIZE)) + 1;
+		int const r1 = static_cast<int>(SDL_floorf((view.y + view.h - mapBounds.y) / CHUNK_SIZE)) + 1;
+		activeChunks = SDL_Rect { c0, r0, c1 - c0 + 1, r1 - r0 + 1 };
 	}
 
-	MIX_Track* loadSoundEffect(MIX_Mixer *mixer, std::string const &filepath)
+	bool isActive(glm::vec2 pos) const
 	{
-		MIX_Audio* audio = MIX_LoadAudio(mixer, filepath.c_str(), true);
-		MIX_Track* track = MIX_CreateTrack(mixer);
-		MIX_SetTrackGain(track, 0.5f);
-		MIX_SetTrackAudio(track, audio);
-		tracks.push_back(track);
-		return track;
+		int const c = static_cast<int>(SDL_floorf((pos.x - mapBounds.x) / CHUNK_SIZE));
+		int const r = static_cast<int>(SDL_floorf((pos.y - mapBounds.y) / CHUNK_SIZE));
+		return c >= activeChunks.x && c < activeChunks.x + activeChunks.w &&
+			r >= activeChunks.y && r < activeChunks.y + activeChunks.h;
 	}
 
-	MIX_Track* loadMusic(MIX_Mixer *mixer, std::string const &filepath)
+	static SDL_FRect tileBounds(GameObject const &tile)
 	{
-		MIX_Audio* audio = MIX_LoadAudio(mixer, filepath.c_str(), true);
-		MIX_Track* track = MIX_CreateTrack(mixer);
-		MIX_SetTrackGain(track, 0.3f);
-		MIX_SetTrackAudio(track, audio);
-		return track;
+		return SDL_FRect {
+			.x = tile.position.x + tile.collider.x,
+			.y = tile.position.y + tile.collider.y,
+			.w = tile.collider.w,
+			.h = tile.collider.h,
+		};
 	}
 
-	void load(SDLState &state)
+	int tileCell(GameObject const &tile) const
 	{
-		playerAnims.resize(5);
-		playerAnims[ANIM_PLAYER_IDLE] = Animation(8, 1.6f);
-		playerAnims[ANIM_PLAYER_RUN] = Animation(4, 0.5f);
-		playerAnims[ANIM_PLAYER_SLIDE] = Animation(1, 1.0f);
-		playerAnims[ANIM_PLAYER_SHOOT] = Animation(4, 0.5f);
-		playerAnims[ANIM_PLAYER_SLIDE_SHOOT] = Animation(4, 0.5f);
-		bulletAnims.resize(2);
-		bulletAnims[ANIM_BULLET_MOVING] = Animation(4, 0.05f);
-		bulletAnims[ANIM_BULLET_HIT] = Animation(4, 0.15f);
-		enemyAnims.resize(3);
-		enemyAnims[ANIM_ENEMY] = Animation(8, 1.0f);
-		enemyAnims[ANIM_ENEMY_HIT] = Animation(8, 1.0f);
-		enemyAnims[ANIM_ENEMY_DIE] = Animation(18, 2.0f);
-
-		texIdle = loadTextures(state.renderer, "data/idle.png");
-		texRun = loadTextures(state.renderer, "data/run.png");
-		texSlide = loadTextures(state.renderer, "data/slide.png");
-		texBrick = loadTextures(state.renderer, "data/tiles/brick.png");
-		texGrass = loadTextures(state.renderer, "data/tiles/grass.png");
-		texGround = loadTextures(state.renderer, "data/tiles/ground.png");
-		texPanel = loadTextures(state.renderer, "data/tiles/panel.png");
-		texBg1 = loadTextures(state.renderer, "data/bg/bg_layer1.png");
-		texBg2 = loadTextures(state.renderer, "data/bg/bg_layer2.png");
-		texBg3 = loadTextures(state.renderer, "data/bg/bg_layer3.png");
-		texBg4 = loadTextures(state.renderer, "data/bg/bg_layer4.png");
-		texBullet = loadTextures(state.renderer, "data/bullet.png");
-		texBulletHit = loadTextures(state.renderer, "data/bullet_hit.png");
-		texShoot = loadTextures(state.renderer, "data/shoot.png");
-		texRunShoot = loadTextures(state.renderer, "data/shoot_run.png");
-		texSlideShoot = loadTextures(state.renderer, "data/slide_shoot.png");
-		texEnemy = loadTextures(state.renderer, "data/enemy.png");
-		texEnemyHit = loadTextures(state.renderer, "data/enemy_hit.png");
-		texEnemyDie = loadTextures(state.renderer, "data/enemy_die.png");
-
-		trackShoot = loadSoundEffect(state.mixer, "data/audio/shoot.wav");
-		trackShootHit = loadSoundEffect(state.mixer, "data/audio/wall_hit.wav");
-		trackEnemyHit = loadSoundEffect(state.mixer, "data/audio/enemy_hit.wav");
-
-		trackMusic = loadMusic(state.mixer, "data/audio/Juhani Junkala [Retro Game Music Pack] Level 1.mp3");
+		int const c = static_cast<int>((tile.position.x - mapBounds.x) / TILE_SIZE);
+		int const r = static_cast<int>((tile.position.y - mapBounds.y) / TILE_SIZE);
+		return c >= 0 && c < tileCols && r >= 0 && r < tileRows ? r * tileCols + c : -1;
 	}
 
-	void unload()
+	// Adds a level tile to or drops it from the level grid and the shot grid,
+	// false when the level grid had no room left for it
+	bool setTileLive(Tileset const &tileset, int index, bool live)
 	{
-		for (SDL_Texture *tex : textures)
+		if (tileLive[index] == live)
 		{
-			SDL_DestroyTexture(tex);
+			return true;
 		}
-
-		for (MIX_Track *track : tracks)
+		GameObject const &tile = layers[LAYER_IDX_LEVEL][index];
+		ObjectRef const ref { LAYER_IDX_LEVEL, index };
+		if (live)
 		{
-			MIX_Audio *audio = MIX_GetTrackAudio(track);
-			MIX_DestroyAudio(audio);
-			MIX_DestroyTrack(track);
+			if (!levelGrid.add(ref, tileBounds(tile)))
+			{
+				return false;
+			}
 		}
-
-		MIX_Audio *audio = MIX_GetTrackAudio(trackMusic);
-		MIX_DestroyAudio(audio);
-		MIX_DestroyTrack(trackMusic);
+		else
+		{
+			levelGrid.remove(ref, tileBounds(tile));
+		}
+		int const cell = tileCell(tile);
+		if (cell >= 0 && (tileset.getFlags(tile.data.level.tile) & TILE_SOLID))
+		{
+			solidTiles[cell] = live;
+		}
+		tileLive[index] = live;
+		return true;
 	}
-};
-
-bool initialize(SDLState &state);
-void cleanup(SDLState &state);
-void drawObject(SDLState const &state, GameState &gs, GameObject &obj, float width, float height, float deltaTime);
-void update(SDLState const &state, GameState &gs, Resources &res, GameObject &obj, float deltaTime);
-void createTiles(SDLState const &state, GameState &gs, Resources &res);
-void checkCollisions(SDLState const &state, GameState &gs, Resources &res, GameObject &a, GameObject &b, float deltaTime);
-void handleKeyInput(SDLState const &state, GameState &gs, GameObject &obj, SDL_Scancode key, bool keyDown);
-void drawParalaxBackground(SDL_Renderer *renderer, SDL_Texture *texture, float xVelocity, float &scrollPos, float scrollFactor, float deltaTime);
 
-int main(int argc, char *argv[])
-{
-	SDLState state;
-	state.width = 1600;
-	state.height = 900;
-	state.logW = 640;
-	state.logH = 320;
+	// Level layer index of the tile covering a point, -1 for none
+	int tileAt(glm::vec2 point) const
+	{
+		int const c = static_cast<int>(SDL_floorf((point.x - mapBounds.x) / TILE_SIZE));
+		int const r = static_cast<int>(SDL_floorf((point.y - mapBounds.y) / TILE_SIZE));
+		return c >= 0 && c < tileCols && r >= 0 && r < tileRows ? tileIndex[r * tileCols + c] : -1;
+	}
 
-	if (!initialize(state))
+	// Takes health from a breakable tile, true when that destroyed it. The
+	// tile stops colliding right away, the derived data catches up in
+	// commitTileChanges at the end of the tick.
+	bool damageTile(int index, Sint16 damage)
 	{
-		return 1;
+		LevelData &tile = layers[LAYER_IDX_LEVEL][index].data.level;
+		if (tile.destroyed || tile.healthPoints <= 0)
+		{
+			return false;
+		}
+		tile.healthPoints = static_cast<Sint16>(std::max(0, tile.healthPoints - damage));
+		if (tile.healthPoints == 0)
+		{
+			tile.destroyed = true;
+			dirtyTiles.push_back(index);
+			return true;
+		}
+		return false;
 	}
 
-	// Load game assets
-	Resources res;
-	res.load(state);
-	SDL_PropertiesID options = SDL_CreateProperties();
-	SDL_SetNumberProperty(options, MIX_PROP_PLAY_LOOPS_NUMBER, -1);
-	MIX_PlayTrack(res.trackMusic, options);
-	SDL_DestroyProperties(options);
+	// Derived data for the whole level layer. Destroyed tiles keep their room
+	// in the level grid so they can be put back without a rebuild.
+	void rebuildLevel(Tileset const &tileset)
+	{
+		std::vector<GameObject> const &level = layers[LAYER_IDX_LEVEL];
+		levelGrid.clear();
+		for (int i = 0; i < level.size(); i++)
+		{
+			levelGrid.insert(ObjectRef { LAYER_IDX_LEVEL, i }, tileBounds(level[i]));
+		}
+		levelGrid.build();
 
-	// Setup game data
-	GameState gs(state);
-	createTiles(state, gs, res);
-	uint64_t prevTime = SDL_GetTicks();
+		solidTiles.assign(static_cast<size_t>(tileCols) * tileRows, 0);
+		tileIndex.assign(static_cast<size_t>(tileCols) * tileRows, -1);
+		tileLive.assign(level.size(), 1);
+		dirtyTiles.reserve(level.size()); // every tile at most once per commit
+		for (int i = 0; i < level.size(); i++)
+		{
+			int const cell = tileCell(level[i]);
+			if (cell >= 0)
+			{
+				tileIndex[cell] = i;
+				solidTiles[cell] = (tileset.getFlags(level[i].data.level.tile) & TILE_SOLID) ? 1 : 0;
+			}
+			if (level[i].data.level.destroyed)
+			{
+				setTileLive(tileset, i, false);
+			}
+		}
+		dirtyTiles.clear();
+		levelGridValid = true;
+	}
 
-	// Start the game loop
-	bool running = true;
-	while (running)
+	// Brings the derived data up to date with the tiles changed since the
+	// last commit, touching only their cells
+	void commitTileChanges(Tileset const &tileset)
 	{
-		uint64_t nowTime = SDL_GetTicks();
-		float deltaTime = (nowTime - prevTime) / 1000.0f;
-		SDL_Event event { 0 };
-		while (SDL_PollEvent(&event))
+		for (int index : dirtyTiles)
 		{
-			switch (event.type)
+			if (!setTileLive(tileset, index, !layers[LAYER_IDX_LEVEL][index].data.level.destroyed))
 			{
-				case SDL_EVENT_QUIT:
-				{
-					running = false;
-					break;
-				}
-				case SDL_EVENT_WINDOW_RESIZED:
-				{
-					state.width = event.window.data1;
-					state.height = event.window.data2;
-					break;
-				}
-				case SDL_EVENT_KEY_DOWN:
-				{
-					handleKeyInput(state, gs, gs.player(), event.key.scancode, true);
-					break;
-				}
-				case SDL_EVENT_KEY_UP:
-				{
-					handleKeyInput(state, gs, gs.player(), event.key.scancode, false);
-					if (event.key.scancode == SDL_SCANCODE_F12)
-					{
-						gs.debugMode = !gs.debugMode;
-					}
-					else if (event.key.scancode == SDL_SCANCODE_F11)
-					{
-						state.fullscreen = !state.fullscreen;
-						SDL_SetWindowFullscreen(state.window, state.fullscreen);
-					}
-					break;
-				}
+				rebuildLevel(tileset);
+				return;
 			}
 		}
+		dirtyTiles.clear();
+	}
 
-		// Update all objects
-		for (auto &layer : gs.layers)
+	// The characters as they are now become the spawn table restart() uses
+	void recordSpawns()
+	{
+		spawns = layers[LAYER_IDX_CHARACTERS];
+		spawnPlayerIndex = playerIndex;
+		spawnRivalIndex = rivalIndex;
+	}
+
+	// Puts the level back to how it started, in place: characters from the
+	// spawn table, tiles whole again, no bullets or particles, camera on the
+	// player. Every list keeps its storage and the characters' animation
+	// lists match in size, so nothing is allocated.
+	void restart(Tileset const &tileset)
+	{
+		std::vector<GameObject> &characters = layers[LAYER_IDX_CHARACTERS];
+		characters.resize(spawns.size());
+		std::copy(spawns.begin(), spawns.end(), characters.begin());
+		playerIndex = spawnPlayerIndex;
+		rivalIndex = spawnRivalIndex;
+
+		std::vector<GameObject> &level = layers[LAYER_IDX_LEVEL];
+		for (int i = 0; i < level.size(); i++)
 		{
-			for (GameObject &obj : layer)
+			LevelData &tile = level[i].data.level;
+			if (tile.destroyed)
 			{
-				update(state, gs, res, obj, deltaTime);
+				tile.destroyed = false;
+				dirtyTiles.push_back(i);
 			}
+			tile.healthPoints = (tileset.getFlags(tile.tile) & TILE_BREAKABLE) ? TILE_HEALTH : 0;
 		}
-
-		// Update bullets
-		for (GameObject &bullet : gs.bullets)
+		if (levelGridValid)
 		{
-			update(state, gs, res, bullet, deltaTime);
+			commitTileChanges(tileset);
 		}
 
-		// Calculate viewport position
-		gs.mapViewport.x = (gs.player().position.x + TILE_SIZE / 2) - gs.mapViewport.w / 2;
+		for (GameObject &bullet : bullets)
+		{
+			bullet.data.bullet.state = BulletState::inactive;
+		}
+		particles.clear();
+		bg2Scroll = bg3Scroll = bg4Scroll = 0;
+		camera.snapTo(focus());
+		updateActiveChunks();
+	}
 
-		// Perform drawing commands
-		SDL_SetRenderDrawColor(state.renderer, 20, 10, 30, 255);
-		SDL_RenderClear(state.renderer);
+	// Every object list in snapshot order
+	template <typename State>
+	static auto objectLists(State &gs)
+	{
+		return std::array { &gs.layers[0], &gs.layers[1], &gs.backgroundTiles, &gs.foregroundTiles, &gs.bullets };
+	}
 
-		// Draw background images
-		SDL_RenderTexture(state.renderer, res.texBg1, nullptr, nullptr);
-		drawParalaxBackground(state.renderer, res.texBg4, gs.player().velocity.x, gs.bg4Scroll, 0.075f, deltaTime);
-		drawParalaxBackground(state.renderer, res.texBg3, gs.player().velocity.x, gs.bg3Scroll, 0.15f, deltaTime);
-		drawParalaxBackground(state.renderer, res.texBg2, gs.player().velocity.x, gs.bg2Scroll, 0.3f, deltaTime);
+	// A snapshot is this header, the records of every object list in order,
+	// then the animation records of all objects. The broadphase grids are left
+	// out: the character grid is rebuilt at the start of every tick, the level
+	// grid is kept across ticks and restore patches it per tile (dirtyTiles)
+	// for the tiles whose destroyed flag changed, rebuilding it only when the
+	// level layer itself differs in size.
+	static Uint32 const SNAPSHOT_VERSION = 3;
+	struct SnapshotHeader
+	{
+		Uint32 version;
+		Uint32 objectCounts[5];
+		Uint32 animationCount;
+		int playerIndex, rivalIndex;
+		Camera camera;
+		SDL_FRect mapBounds;
+		SDL_Rect activeChunks;
+		float bg2Scroll, bg3Scroll, bg4Scroll;
+		Uint64 rngState;
+		bool debugMode;
+	};
 
-		// Draw background tiles
-		for (GameObject &obj : gs.backgroundTiles)
+	void save(Snapshot &snap, SnapshotIds const &ids) const
+	{
+		auto const lists = objectLists(*this);
+		size_t objects = 0, animations = 0;
+		for (std::vector<GameObject> const *list : lists)
 		{
-			SDL_FRect dst {
-				.x = obj.position.x - gs.mapViewport.x,
-				.y = obj.position.y,
-				.w = static_cast<float>(obj.texture->w),
-				.h = static_cast<float>(obj.texture->h),
-			};
-			SDL_RenderTexture(state.renderer, obj.texture, nullptr, &dst);
+			objects += list->size();
+			for (GameObject const &obj : *list)
+			{
+				animations += obj.animations.size();
+			}
 		}
 
-		// Draw all objects
-		for (auto &layer : gs.layers)
+		snap.clear();
+		snap.reserve(sizeof(SnapshotHeader) + objects * sizeof(ObjectRecord) + animations * sizeof(AnimationRecord) +
+			alignof(ObjectRecord) + alignof(AnimationRecord));
+		SnapshotHeader *header = snap.append<SnapshotHeader>(1);
+		ObjectRecord *records = snap.append<ObjectRecord>(objects);
+		AnimationRecord *anims = snap.append<AnimationRecord>(animations);
+
+		header->version = SNAPSHOT_VERSION;
+		header->animationCount = static_cast<Uint32>(animations);
+		header->playerIndex = playerIndex;
+		header->rivalIndex = rivalIndex;
+		header->camera = camera;
+		header->mapBounds = mapBounds;
+		header->activeChunks = activeChunks;
+		header->bg2Scroll = bg2Scroll;
+		header->bg3Scroll = bg3Scroll;
+		header->bg4Scroll = bg4Scroll;
+		header->rngState = rngState;
+		header->debugMode = debugMode;
+		for (size_t i = 0; i < lists.size(); i++)
 		{
-			for (GameObject &obj : layer)
+			header->objectCounts[i] = static_cast<Uint32>(lists[i]->size());
+			for (GameObject const &obj : *lists[i])
 			{
-				drawObject(state, gs, obj, TILE_SIZE, TILE_SIZE, deltaTime);
+				records->save(obj, ids, anims);
+				anims += obj.animations.size();
+				records++;
 			}
 		}
+	}
 
-		// Draw bullets
-		for (GameObject &bullet : gs.bullets)
+	// Object lists keep their memory, restoring into a state of the same shape does not allocate
+	bool restore(Snapshot const &snap, SnapshotIds const &ids)
+	{
+		size_t offset = 0;
+		SnapshotHeader const *header = snap.read<SnapshotHeader>(offset, 1);
+		if (!header || header->version != SNAPSHOT_VERSION)
 		{
-			if (bullet.data.bullet.state != BulletState::inactive)
-			{
-				drawObject(state, gs, bullet, bullet.collider.w, bullet.collider.h, deltaTime);
-			}
+			return false;
+		}
+		size_t objects = 0;
+		for (Uint32 count : header->objectCounts)
+		{
+			objects += count;
+		}
+		ObjectRecord const *records = snap.read<ObjectRecord>(offset, objects);
+		AnimationRecord const *anims = snap.read<AnimationRecord>(offset, header->animationCount);
+		if (!records || !anims)
+		{
+			return false;
 		}
 
-		// Draw foreground tiles
-		for (GameObject &obj : gs.foregroundTiles)
+		// Validate the whole blob first, a failed restore leaves the state as it was
+		size_t animationCount = 0;
+		for (size_t i = 0; i < objects; i++)
 		{
-			SDL_FRect dst {
-				.x = obj.position.x - gs.mapViewport.x,
-				.y = obj.position.y,
-				.w = static_cast<float>(obj.texture->w),
-				.h = static_cast<float>(obj.texture->h),
-			};
-			SDL_RenderTexture(state.renderer, obj.texture, nullptr, &dst);
+			animationCount += records[i].animationCount;
+		}
+		int const characterCount = static_cast<int>(header->objectCounts[LAYER_IDX_CHARACTERS]);
+		if (animationCount != header->animationCount ||
+			header->playerIndex < 0 || header->playerIndex >= characterCount ||
+			header->rivalIndex < -1 || header->rivalIndex >= characterCount)
+		{
+			return false;
 		}
 
-		// Display some debug info
-		if (gs.debugMode)
+		// The level grid only goes stale when the level layer itself changed,
+		// tiles destroyed or brought back by the restore are committed singly
+		bool const sameLevel = header->objectCounts[LAYER_IDX_LEVEL] == layers[LAYER_IDX_LEVEL].size();
+		if (!sameLevel)
 		{
-			SDL_SetRenderDrawColor(state.renderer, 255, 255, 255, 255);
-			SDL_RenderDebugText(state.renderer, 5, 5, std::format(
-				"S: {}, B: {}, G: {}",
-				static_cast<int>(gs.player().data.player.state),
-				gs.bullets.size(),
-				gs.player().grounded
-			).c_str());
+			levelGridValid = false;
 		}
 
-		// Swap buffers and present
-		SDL_RenderPresent(state.renderer);
-		prevTime = nowTime;
+		auto const lists = objectLists(*this);
+		for (size_t i = 0; i < lists.size(); i++)
+		{
+			lists[i]->resize(header->objectCounts[i]);
+			bool const trackTiles = i == LAYER_IDX_LEVEL && sameLevel;
+			for (int j = 0; j < lists[i]->size(); j++)
+			{
+				GameObject &obj = (*lists[i])[j];
+				bool const wasDestroyed = trackTiles && obj.data.level.destroyed;
+				records->restore(obj, ids, anims);
+				anims += records->animationCount;
+				records++;
+				if (trackTiles && obj.data.level.destroyed != wasDestroyed)
+				{
+					dirtyTiles.push_back(j);
+				}
+			}
+		}
+		playerIndex = header->playerIndex;
+		rivalIndex = header->rivalIndex;
+		camera = header->camera;
+		mapBounds = header->mapBounds;
+		activeChunks = header->activeChunks;
+		bg2Scroll = header->bg2Scroll;
+		bg3Scroll = header->bg3Scroll;
+		bg4Scroll = header->bg4Scroll;
+		rngState = header->rngState;
+		debugMode = header->debugMode;
+		return true;
 	}
+};
 
-	res.unload();
-	cleanup(state);
-	return 0;
-}
-
-bool initialize(SDLState &state)
+struct Resources
 {
-	bool initSuccess = true;
+	int const ANIM_PLAYER_IDLE = 0;
+	int const ANIM_PLAYER_RUN = 1;
+	int const ANIM_PLAYER_SLIDE = 2;
+	int const ANIM_PLAYER_SHOOT = 3;
+	int const ANIM_PLAYER_SLIDE_SHOOT = 4;
+	int const ANIM_PLAYER_RUN_SHOOT = 5;
+	std::vector<Animation> playerAnims;
+	int const ANIM_BULLET_MOVING = 0;
+	int const ANIM_BULLET_HIT = 1;
+	std::vector<Animation> bulletAnims;
+	int const ANIM_ENEMY = 0;
+	int const ANIM_ENEMY_HIT = 1;
+	int const ANIM_ENEMY_DIE = 2;
+	std::vector<Animation> enemyAnims;
 
-	if (!SDL_Init(SDL_INIT_VIDEO))
-	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error initializing SDL3", nullptr);
-		initSuccess = false;
-	}
+	std::vector<SDL_Texture *> textures;
+	SDL_Texture *texBg1, *texBg2, *texBg3, *texBg4;
 
-	// Create the window
-	state.window = SDL_CreateWindow("SDL3 Demo", state.width, state.height, SDL_WINDOW_RESIZABLE);
+	// Animation clips, each drawn with the texture of its image, the level and
+	// the texture of every tile, indexed by gid
+	SpriteSheet sprites;
+	TileMap map;
+	std::vector<SDL_Texture *> tileTextures;
 
-	if (!state.window)
-	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error creating window", state.window);
-		cleanup(state);
-		initSuccess = false;
-	}
+	ParallaxBackground background;
+	int bgLayer2, bgLayer3, bgLayer4;
 
-	// Create the renderer
-	state.renderer = SDL_CreateRenderer(state.window, nullptr);
+	std::vector<MIX_Track*> tracks;
+	MIX_Track *trackShoot, *trackShootHit, *trackEnemyHit;
+	MIX_Track *trackMusic;
 
-	if (!state.renderer)
-	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error creating renderer", state.window);
-		cleanup(state);
-		initSuccess = false;
-	}
+	ResourceCache cache;
 
-	// Configure presentation
-	SDL_SetRenderVSync(state.renderer, 1);
-	SDL_SetRenderLogicalPresentation(state.renderer, state.logW, state.logH, SDL_LOGICAL_PRESENTATION_LETTERBOX);
+	// Every texture and sound the game loads, so they can be decoded ahead of time
+	struct TextureFile
+	{
+		SDL_Texture *Resources::*texture;
+		char const *path;
+	};
+	static constexpr TextureFile TEXTURE_FILES[] = {
+		{ &Resources::texBg1, "data/bg/bg_layer1.png" },
+		{ &Resources::texBg2, "data/bg/bg_layer2.png" },
+		{ &Resources::texBg3, "data/bg/bg_layer3.png" },
+		{ &Resources::texBg4, "data/bg/bg_layer4.png" },
+	};
+	struct SoundFile
+	{
+		MIX_Track *Resources::*track;
+		char const *path;
+		bool music;
+	};
+	static constexpr SoundFile SOUND_FILES[] = {
+		{ &Resources::trackShoot, "data/audio/shoot.wav", false },
+		{ &Resources::trackShootHit, "data/audio/wall_hit.wav", false },
+		{ &Resources::trackEnemyHit, "data/audio/enemy_hit.wav", false },
+		{ &Resources::trackMusic, "data/audio/Juhani Junkala [Retro Game Music Pack] Level 1.mp3", true },
+	};
+	std::vector<std::string> imagePaths; // TEXTURE_FILES, the tile images, then the clip images
+	std::vector<SDL_Surface *> decodedImages;
+	std::vector<MIX_Audio *> decodedAudio;
 
-	if (!MIX_Init())
+	SDL_Texture *loadTextures(SDL_Renderer *renderer, std::string const &filepath, SDL_Surface *decoded = nullptr)
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error initializing SDL3_mixer", state.window);
-		cleanup(state);
-		initSuccess = false;
+		SDL_Texture *tex = cache.acquireTexture(renderer, filepath, decoded);
+		textures.push_back(tex);
+		return tex;
 	}
 
-	state.mixer = MIX_CreateMixerDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, nullptr);
-	if (!state.mixer)
+	// Points every reference held by the resources at a replacement texture
+	void replaceTexture(SDL_Texture *oldTex, SDL_Texture *newTex)
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error creating mixer on default device", state.window);
-		cleanup(state);
-		initSuccess = false;
+		for (TextureFile const &file : TEXTURE_FILES)
+		{
+			if (this->*file.texture == oldTex)
+			{
+				this->*file.texture = newTex;
+			}
+		}
+		std::replace(textures.begin(), textures.end(), oldTex, newTex);
+		std::replace(tileTextures.begin(), tileTextures.end(), oldTex, newTex);
+		sprites.replaceTexture(oldTex, newTex);
+		background.replaceTexture(oldTex, newTex);
 	}
 
-	return initSuccess;
-}
+	MIX_Track* loadSoundEffect(MIX_Mixer *mixer, std::string const &filepath, MIX_Audio *decoded = nullptr)
+	{
+		MIX_Audio* audio = cache.acquireAudio(mixer, filepath, decoded);
+		MIX_Track* track = MIX_CreateTrack(mixer);
+		MIX_SetTrackGain(track, SFX_GAIN);
+		MIX_SetTrackAudio(track, audio);
+		tracks.push_back(track);
+		return track;
+	}
+
+	MIX_Track* loadMusic(MIX_Mixer *mixer, std::string const &filepath, MIX_Audio *decoded = nullptr)
+	{
+		MIX_Audio* audio = cache.acquireAudio(mixer, filepath, decoded);
+		MIX_Track* track = MIX_CreateTrack(mixer);
+		MIX_SetTrackGain(track, 0.3f);
+		MIX_SetTrackAudio(track, audio);
+		return track;
+	}
+
+	// Image decoding needs neither the renderer nor an initialized SDL, start it
+	// first. The map must be loaded to know the tile images.
+	void decodeImages(TaskGroup &tasks)
+	{
+		imagePaths.clear();
+		for (TextureFile const &file : TEXTURE_FILES)
+		{
+			imagePaths.push_back(file.path);
+		}
+		for (int gid = 0; gid < map.tileset.getCount(); gid++)
+		{
+			if (!map.tileset.getImage(gid).empty())
+			{
+				imagePaths.push_back(map.tileset.getImage(gid));
+			}
+		}
+		// Sheets of the animation clips
+		for (SpriteClip const &clip : sprites.getClips())
+		{
+			if (std::find(imagePaths.begin(), imagePaths.end(), clip.image) == imagePaths.end())
+			{
+				imagePaths.push_back(clip.image);
+			}
+		}
+
+		int const count = static_cast<int>(imagePaths.size());
+		int const workers = std::clamp(SDL_GetNumLogicalCPUCores() - 1, 1, 4);
+		decodedImages.assign(count, nullptr);
+		for (int w = 0; w < workers; w++)
+		{
+			tasks.run("decode images", [this, w, workers, count]()
+			{
+				for (int i = w; i < count; i += workers)
+				{
+					decodedImages[i] = IMG_Load(imagePaths[i].c_str());
+				}
+			});
+		}
+	}
+
+	void decodeAudio(TaskGroup &tasks, MIX_Mixer *mixer)
+	{
+		decodedAudio.assign(std::size(SOUND_FILES), nullptr);
+		tasks.run("decode audio", [this, mixer]()
+		{
+			for (size_t i = 0; i < std::size(SOUND_FILES); i++)
+			{
+				decodedAudio[i] = MIX_LoadAudio(mixer, SOUND_FILES[i].path, true);
+			}
+		});
+	}
+
+	void createAnimations()
+	{
+		playerAnims.resize(6);
+		playerAnims[ANIM_PLAYER_IDLE] = Animation(sprites.clip("player_idle"));
+		playerAnims[ANIM_PLAYER_RUN] = Animation(sprites.clip("player_run"));
+		playerAnims[ANIM_PLAYER_SLIDE] = Animation(sprites.clip("player_slide"));
+		playerAnims[ANIM_PLAYER_SHOOT] = Animation(sprites.clip("player_shoot"));
+		playerAnims[ANIM_PLAYER_SLIDE_SHOOT] = Animation(sprites.clip("player_slide_shoot"));
+		playerAnims[ANIM_PLAYER_RUN_SHOOT] = Animation(sprites.clip("player_run_shoot"));
+		bulletAnims.resize(2);
+		bulletAnims[ANIM_BULLET_MOVING] = Animation(sprites.clip("bullet"));
+		bulletAnims[ANIM_BULLET_HIT] = Animation(sprites.clip("bullet_hit"));
+		enemyAnims.resize(3);
+		enemyAnims[ANIM_ENEMY] = Animation(sprites.clip("enemy"));
+		enemyAnims[ANIM_ENEMY_HIT] = Animation(sprites.clip("enemy_hit"));
+		enemyAnims[ANIM_ENEMY_DIE] = Animation(sprites.clip("enemy_die"));
+	}
+
+	// Blank textures in place of every image, for benchmarks that need the
+	// objects and their texture ids but never draw
+	void createPlaceholders(SDL_Renderer *renderer)
+	{
+		auto const placeholder = [this, renderer]()
+		{
+			SDL_Texture *tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, TILE_SIZE, TILE_SIZE);
+			textures.push_back(tex);
+			return tex;
+		};
+		for (TextureFile const &file : TEXTURE_FILES)
+		{
+			this->*file.texture = placeholder();
+		}
+		tileTextures.assign(map.tileset.getCount(), nullptr);
+		for (int gid = 0; gid < map.tileset.getCount(); gid++)
+		{
+			if (!map.tileset.getImage(gid).empty())
+			{
+				tileTextures[gid] = placeholder();
+			}
+		}
+		for (SpriteClip const &clip : sprites.getClips())
+		{
+			if (!clip.texture)
+			{
+				sprites.bindTexture(clip.image, placeholder());
+			}
+		}
+	}
+
+	void load(SDLState &state, TaskGroup &tasks)
+	{
+		createAnimations();
+		uploadImages(state, tasks);
+		createTracks(state, tasks);
+	}
+
+	// Upload the decoded images, textures must be created on the main thread
+	void uploadImages(SDLState &state, TaskGroup &tasks)
+	{
+		tasks.wait("decode images");
+		int phase = state.startup.begin("textures");
+		size_t i = 0;
+		for (; i < std::size(TEXTURE_FILES); i++)
+		{
+			this->*TEXTURE_FILES[i].texture = loadTextures(state.renderer, imagePaths[i], decodedImages[i]);
+		}
+		tileTextures.assign(map.tileset.getCount(), nullptr);
+		for (int gid = 0; gid < map.tileset.getCount(); gid++)
+		{
+			if (!map.tileset.getImage(gid).empty())
+			{
+				tileTextures[gid] = loadTextures(state.renderer, imagePaths[i], decodedImages[i]);
+				i++;
+			}
+		}
+		for (; i < imagePaths.size(); i++)
+		{
+			loadTextures(state.renderer, imagePaths[i], decodedImages[i]);
+		}
+		bindClipTextures(state.renderer);
+		for (SDL_Surface *surface : decodedImages)
+		{
+			SDL_DestroySurface(surface);
+		}
+		decodedImages.clear();
+
+		background.create(state.renderer, state.logW, state.logH, SDL_Color { 20, 10, 30, 255 }, texBg1);
+		bgLayer4 = background.addLayer(texBg4, 10);
+		bgLayer3 = background.addLayer(texBg3, 10);
+		bgLayer2 = background.addLayer(texBg2, 10);
+		state.startup.end(phase);
+	}
+
+	// Gives every clip the texture of its image, loading images not used yet
+	void bindClipTextures(SDL_Renderer *renderer)
+	{
+		for (SpriteClip const &clip : sprites.getClips())
+		{
+			if (!clip.texture)
+			{
+				SDL_Texture *tex = cache.findTexture(clip.image);
+				if (!tex)
+				{
+					tex = loadTextures(renderer, clip.image);
+				}
+				if (tex)
+				{
+					sprites.bindTexture(clip.image, tex);
+					sprites.validate(clip.image, tex->w, tex->h);
+				}
+			}
+		}
+	}
+
+	// Tile textures for a map loaded after startup, images already used are shared
+	void bindTileTextures(SDL_Renderer *renderer)
+	{
+		tileTextures.assign(map.tileset.getCount(), nullptr);
+		for (int gid = 0; gid < map.tileset.getCount(); gid++)
+		{
+			std::string const &image = map.tileset.getImage(gid);
+			if (!image.empty())
+			{
+				SDL_Texture *tex = cache.findTexture(image);
+				tileTextures[gid] = tex ? tex : loadTextures(renderer, image);
+			}
+		}
+	}
+
+	void createTracks(SDLState &state, TaskGroup &tasks)
+	{
+		tasks.wait("decode audio");
+		int const phase = state.startup.begin("tracks");
+		for (size_t i = 0; i < std::size(SOUND_FILES); i++)
+		{
+			SoundFile const &file = SOUND_FILES[i];
+			this->*file.track = file.music
+				? loadMusic(state.mixer, file.path, decodedAudio[i])
+				: loadSoundEffect(state.mixer, file.path, decodedAudio[i]);
+		}
+		decodedAudio.clear();
+		state.startup.end(phase);
+	}
+
+	void unload()
+	{
+		background.destroy();
+
+		for (SDL_Texture *tex : textures)
+		{
+			cache.releaseTexture(tex);
+		}
+		textures.clear();
+
+		for (MIX_Track *track : tracks)
+		{
+			cache.releaseAudio(MIX_GetTrackAudio(track));
+			MIX_DestroyTrack(track);
+		}
+		tracks.clear();
+
+		cache.releaseAudio(MIX_GetTrackAudio(trackMusic));
+		MIX_DestroyTrack(trackMusic);
+
+		// Shutting down, drop what is still cached
+		cache.clear();
+	}
+};
+
+bool initialize(SDLState &state, TaskGroup &tasks);
+void cleanup(SDLState &state);
+void drawScene(SDLState &state, GameState &gs, Resources &res, ScenePassStats *profile = nullptr);
+void drawObject(SDLState &state, GameState &gs, GameObject &obj, float width, float height);
+void update(SDLState const &state, GameState &gs, Resources &res, GameObject &obj, float deltaTime);
+void simulate(SDLState const &state, GameState &gs, Resources &res, float deltaTime);
+void createTiles(SDLState const &state, GameState &gs, Resources &res);
+void addRival(GameState &gs);
+void checkCollisions(SDLState const &state, GameState &gs, Resources &res, GameObject &a, GameObject &b, float deltaTime);
+void emitParticles(SDLState const &state, GameState &gs, ParticleBurst const &burst, glm::vec2 pos, float angle, int count);
+void damageEnemy(SDLState const &state, GameState &gs, Resources &res, GameObject &enemy, float direction);
+void damageTile(SDLState const &state, GameState &gs, int index);
+void fireHitscan(SDLState const &state, GameState &gs, Resources &res, GameObject &shooter, glm::vec2 muzzle);
+void handleKeyInput(SDLState &state, SDL_KeyboardEvent const &key);
+Uint8 sampleInput(SDLState &state);
+void updateFrameInterval(SDLState &state);
+void waitForLateInput(SDLState const &state, Uint64 presentedAt);
+void updateParalaxBackground(float width, float xVelocity, float &scrollPos, float scrollFactor, float deltaTime);
+void blitScene(SDLState &state);
+void drawHud(SDLState &state, GameState &gs, Resources &res, RollbackSession const &net);
+void buildBroadphase(GameState &gs, Tileset const &tileset);
+bool applyReloads(SDLState &state, GameState &gs, Resources &res, std::vector<ReloadedAsset> &assets, bool levelReloads);
+void drawDebugOverlay(SDLState &state, GameState &gs);
+int runMapBenchmark(std::string const &mapPath);
+int runSnapshotBenchmark(std::string const &mapPath);
+int runParticleBenchmark();
+int runRestartBenchmark(std::string const &mapPath);
+int runRenderBenchmark(std::string const &mapPath);
+double stateFingerprint(GameState const &gs);
+
+int main(int argc, char *argv[])
+{
+	SDLState state;
+	state.width = 1600;
+	state.height = 900;
+	state.logW = 640;
+	state.logH = 320;
+
+	bool hotReload = false;
+	bool startupBench = false;
+	bool mapBench = false;
+	bool snapshotBench = false;
+	bool particleBench = false;
+	bool restartBench = false;
+	bool renderBench = false;
+	bool runInBackground = false;
+	std::string mapPath = "data/maps/largemap.tmx";
+	size_t cacheBudget = 0;
+	char const *netHost = nullptr;
+	int netPort = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (SDL_strcmp(argv[i], "--capture-raw") == 0)
+		{
+			state.capture.setFormat(CaptureFormat::raw);
+		}
+		else if (SDL_strcmp(argv[i], "--hot-reload") == 0)
+		{
+			hotReload = true;
+		}
+		else if (SDL_strcmp(argv[i], "--map") == 0 && i + 1 < argc)
+		{
+			mapPath = argv[++i];
+		}
+		else if (SDL_strcmp(argv[i], "--map-bench") == 0)
+		{
+			mapBench = true;
+		}
+		else if (SDL_strcmp(argv[i], "--snapshot-bench") == 0)
+		{
+			snapshotBench = true;
+		}
+		else if (SDL_strcmp(argv[i], "--particle-bench") == 0)
+		{
+			particleBench = true;
+		}
+		else if (SDL_strcmp(argv[i], "--restart-bench") == 0)
+		{
+			restartBench = true;
+		}
+		else if (SDL_strcmp(argv[i], "--render-bench") == 0)
+		{
+			renderBench = true;
+		}
+		else if (SDL_strcmp(argv[i], "--startup-bench") == 0)
+		{
+			startupBench = true;
+		}
+		else if (SDL_strcmp(argv[i], "--run-in-background") == 0)
+		{
+			runInBackground = true;
+		}
+		else if (SDL_strcmp(argv[i], "--latency") == 0)
+		{
+			state.latency.setEnabled(true);
+		}
+		else if (SDL_strcmp(argv[i], "--late-input") == 0)
+		{
+			state.lateInput = true;
+		}
+		else if (SDL_strcmp(argv[i], "--cache-budget-mb") == 0 && i + 1 < argc)
+		{
+			cacheBudget = static_cast<size_t>(SDL_atoi(argv[++i])) * 1024 * 1024;
+		}
+		else if (SDL_strcmp(argv[i], "--net-host") == 0 && i + 1 < argc)
+		{
+			netHost = nullptr;
+			netPort = SDL_atoi(argv[++i]);
+		}
+		else if (SDL_strcmp(argv[i], "--net-join") == 0 && i + 2 < argc)
+		{
+			netHost = argv[++i];
+			netPort = SDL_atoi(argv[++i]);
+		}
+	}
+
+	if (mapBench)
+	{
+		return runMapBenchmark(mapPath);
+	}
+	if (snapshotBench)
+	{
+		return runSnapshotBenchmark(mapPath);
+	}
+	if (particleBench)
+	{
+		return runParticleBenchmark();
+	}
+	if (restartBench)
+	{
+		return runRestartBenchmark(mapPath);
+	}
+	if (renderBench)
+	{
+		return runRenderBenchmark(mapPath);
+	}
+
+	// Independent startup work runs on workers while the main thread brings up video
+	TaskGroup tasks(state.startup);
+	Resources res;
+	int const mapPhase = state.startup.begin("metadata");
+	if (!res.map.load(mapPath, "data/tiles") || !res.sprites.load("data/sprites.xml"))
+	{
+		return 1;
+	}
+	state.startup.end(mapPhase);
+	res.decodeImages(tasks);
+	if (!initialize(state, tasks))
+	{
+		tasks.waitAll();
+		cleanup(state);
+		return 1;
+	}
+	tasks.wait("audio device");
+	if (!state.mixer)
+	{
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error creating mixer on default device", state.window);
+		tasks.waitAll();
+		cleanup(state);
+		return 1;
+	}
+	res.decodeAudio(tasks, state.mixer);
+
+	// Load game assets
+	if (cacheBudget)
+	{
+		res.cache.setBudget(cacheBudget);
+	}
+	res.load(state, tasks);
+	SDL_PropertiesID options = SDL_CreateProperties();
+	SDL_SetNumberProperty(options, MIX_PROP_PLAY_LOOPS_NUMBER, -1);
+	MIX_PlayTrack(res.trackMusic, options);
+	SDL_DestroyProperties(options);
+
+	// Watch the asset tree for changes
+	AssetWatcher watcher;
+	std::vector<ReloadedAsset> reloaded;
+	if (hotReload)
+	{
+		watcher.setMetadata(mapPath, "data/tiles", "data/sprites.xml");
+		watcher.start("data", state.mixer);
+	}
+
+	// Setup game data
+	int const tilesPhase = state.startup.begin("tiles");
+	GameState gs(state, res.map);
+	createTiles(state, gs, res);
+	state.startup.end(tilesPhase);
+
+	// Both peers of a net session must simulate the same way: same level, same
+	// seed, fixed ticks and no quality steps that change the simulation
+	RollbackSession net;
+	float netAccumulator = 0;
+	if (netPort)
+	{
+		if (!(netHost ? net.join(netHost, static_cast<Uint16>(netPort)) : net.host(static_cast<Uint16>(netPort))))
+		{
+			res.unload();
+			cleanup(state);
+			return 1;
+		}
+		net.setHeldMask(INPUT_HELD);
+		addRival(gs);
+		gs.rngState = NET_SEED;
+		state.quality.setEnabled(false);
+		runInBackground = true; // the peer keeps playing
+	}
+	state.idle.setRunInBackground(runInBackground);
+	gs.camera.snapTo(gs.focus());
+	gs.recordSpawns();
+	Snapshot checkpoint;
+	uint64_t prevTime = SDL_GetTicks();
+	Uint64 presentedAt = 0;
+	Uint64 simulatedTicks = 0; // ticks run outside of net sessions
+
+	// Start the game loop
+	bool running = true;
+	while (running)
+	{
+		// Sleep while there is nothing to draw, events wake the loop up
+		state.idle.wait();
+		if (state.lateInput && presentedAt && state.idle.isVisible())
+		{
+			waitForLateInput(state, presentedAt);
+		}
+
+		uint64_t const workStart = SDL_GetPerformanceCounter();
+		uint64_t nowTime = SDL_GetTicks();
+		float deltaTime = (nowTime - prevTime) / 1000.0f;
+		// Swap in assets that changed on disk, between two frames
+		watcher.takeReady(reloaded);
+		// A net peer cannot change its level alone, those reloads are skipped.
+		// Snapshots of the previous level or clips no longer restore.
+		if (!reloaded.empty() && applyReloads(state, gs, res, reloaded, !netPort))
+		{
+			checkpoint.clear();
+		}
+
+		bool const wasPaused = state.idle.isPaused();
+		SDL_Event event { 0 };
+		while (SDL_PollEvent(&event))
+		{
+			state.idle.handleEvent(event);
+			switch (event.type)
+			{
+				case SDL_EVENT_QUIT:
+				{
+					running = false;
+					break;
+				}
+				case SDL_EVENT_RENDER_TARGETS_RESET:
+				{
+					res.background.invalidate();
+					break;
+				}
+				case SDL_EVENT_WINDOW_RESIZED:
+				{
+					state.width = event.window.data1;
+					state.height = event.window.data2;
+					break;
+				}
+				case SDL_EVENT_WINDOW_DISPLAY_CHANGED:
+				{
+					updateFrameInterval(state);
+					break;
+				}
+				case SDL_EVENT_KEY_DOWN:
+				{
+					handleKeyInput(state, event.key);
+					break;
+				}
+				case SDL_EVENT_KEY_UP:
+				{
+					handleKeyInput(state, event.key);
+					if (event.key.scancode == SDL_SCANCODE_F12)
+					{
+						gs.debugMode = !gs.debugMode;
+					}
+					else if (event.key.scancode == SDL_SCANCODE_F11)
+					{
+						state.fullscreen = !state.fullscreen;
+						SDL_SetWindowFullscreen(state.window, state.fullscreen);
+					}
+					else if (event.key.scancode == SDL_SCANCODE_F10)
+					{
+						state.integerScale = !state.integerScale;
+					}
+					else if (event.key.scancode == SDL_SCANCODE_F9 && !netPort)
+					{
+						state.quality.setEnabled(!state.quality.isEnabled());
+					}
+					else if (event.key.scancode == SDL_SCANCODE_F5 && !netPort)
+					{
+						gs.save(checkpoint, SnapshotIds(res.textures, res.sprites));
+						SDL_Log("Checkpoint saved, %zu bytes", checkpoint.getSize());
+					}
+					else if (event.key.scancode == SDL_SCANCODE_F6 && checkpoint.getSize() && !netPort)
+					{
+						if (!gs.restore(checkpoint, SnapshotIds(res.textures, res.sprites)))
+						{
+							SDL_Log("Checkpoint does not restore, keeping the current state");
+						}
+					}
+					else if (event.key.scancode == SDL_SCANCODE_F7 && !netPort)
+					{
+						uint64_t const begin = SDL_GetPerformanceCounter();
+						gs.restart(res.map.tileset);
+						SDL_Log("Level restarted in %.3f ms", static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1000.0 /
+							SDL_GetPerformanceFrequency());
+					}
+					else if (event.key.scancode == SDL_SCANCODE_F8)
+					{
+						if (state.capture.isRunning())
+						{
+							state.capture.stop();
+						}
+						else
+						{
+							state.capture.start("capture", state.logW, state.logH);
+						}
+					}
+					break;
+				}
+			}
+		}
+
+		// Time spent paused is not simulated, and tracks stay silent meanwhile
+		if (wasPaused != state.idle.isPaused())
+		{
+			if (wasPaused)
+			{
+				MIX_ResumeAllTracks(state.mixer);
+				deltaTime = 0;
+			}
+			else
+			{
+				MIX_PauseAllTracks(state.mixer);
+			}
+		}
+
+		if (netPort)
+		{
+			// Fixed ticks, corrected by rollback when the remote input arrives
+			SnapshotIds const ids(res.textures, res.sprites);
+			auto const save = [&gs, &ids](Snapshot &snap) { gs.save(snap, ids); };
+			auto const restore = [&gs, &ids](Snapshot const &snap)
+			{
+				bool const debugMode = gs.debugMode; // a local view setting
+				bool const restored = gs.restore(snap, ids);
+				gs.debugMode = debugMode;
+				return restored;
+			};
+			auto const step = [&state, &gs, &res](Uint8 const inputs[2], bool replay)
+			{
+				gs.player().data.player.input = inputs[0];
+				gs.rival().data.player.input = inputs[1];
+				gs.silent = replay;
+				simulate(state, gs, res, NET_TICK);
+				gs.silent = false;
+			};
+
+			net.receive();
+			net.rollback(save, restore, step);
+			netAccumulator = std::min(netAccumulator + deltaTime, NET_TICK * RollbackSession::MAX_ROLLBACK);
+			Uint8 input = sampleInput(state);
+			while (netAccumulator >= NET_TICK && net.canAdvance())
+			{
+				state.latency.consume(net.getTick() + RollbackSession::INPUT_DELAY);
+				net.advance(input, save, step);
+				input &= ~(INPUT_JUMP | INPUT_SWITCH_WEAPON);
+				state.pressedButtons = 0;
+				netAccumulator -= NET_TICK;
+			}
+			net.send();
+		}
+		else if (!state.idle.isPaused())
+		{
+			gs.player().data.player.input = sampleInput(state);
+			state.pressedButtons = 0;
+			state.latency.consume(simulatedTicks);
+			simulate(state, gs, res, deltaTime);
+			simulatedTicks++;
+		}
+
+		if (!state.idle.shouldRender())
+		{
+			prevTime = nowTime;
+			continue;
+		}
+
+		// Perform drawing commands into the logical-resolution scene target
+		state.gfx.beginFrame();
+		state.gfx.setTarget(state.sceneTarget);
+		bool const lowResolution = state.quality.atLeast(QualityLevel::lowResolution);
+		if (lowResolution)
+		{
+			// Draw the world into the top-left quarter of the scene target
+			state.gfx.setScale(0.5f);
+		}
+
+		drawScene(state, gs, res);
+
+		// Display debug geometry
+		if (gs.debugMode && !state.quality.atLeast(QualityLevel::noDebugOverlay))
+		{
+			drawDebugOverlay(state, gs);
+		}
+		if (lowResolution)
+		{
+			state.gfx.setScale(1.0f);
+		}
+
+		// Record the logical-resolution frame
+		if (state.capture.isRunning())
+		{
+			int const captureScale = lowResolution ? 2 : 1;
+			state.capture.capture(state.renderer, SDL_Rect { 0, 0, state.logW / captureScale, state.logH / captureScale });
+		}
+
+		// Upscale the scene to the window, then draw the HUD on top of it
+		blitScene(state);
+		if (gs.debugMode)
+		{
+			drawHud(state, gs, res, net);
+		}
+
+		// Let the quality governor adjust to the work time of this frame
+		uint64_t const workEnd = SDL_GetPerformanceCounter();
+		state.quality.update(static_cast<float>(workEnd - workStart) / SDL_GetPerformanceFrequency());
+
+		// Swap buffers and present
+		state.gfx.present();
+		presentedAt = SDL_GetTicksNS();
+		state.latency.presented(netPort ? net.getTick() : simulatedTicks);
+		prevTime = nowTime;
+
+		if (!state.startup.isReported())
+		{
+			state.startup.report();
+			running = !startupBench;
+		}
+	}
+
+	state.capture.stop();
+	watcher.stop();
+	res.unload();
+	cleanup(state);
+	return 0;
+}
+
+bool initialize(SDLState &state, TaskGroup &tasks)
+{
+	bool initSuccess = true;
+
+	int phase = state.startup.begin("sdl init");
+	if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO))
+	{
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error initializing SDL3", nullptr);
+		return false;
+	}
+	state.startup.end(phase);
+
+	// Opening the audio device does not depend on the window, do it meanwhile
+	tasks.run("audio device", [&state]()
+	{
+		if (MIX_Init())
+		{
+			state.mixer = MIX_CreateMixerDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, nullptr);
+		}
+	});
+
+	// Create the window
+	phase = state.startup.begin("window");
+	state.window = SDL_CreateWindow("SDL3 Demo", state.width, state.height, SDL_WINDOW_RESIZABLE);
+	state.startup.end(phase);
+
+	if (!state.window)
+	{
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error creating window", state.window);
+		initSuccess = false;
+	}
+
+	// Create the renderer
+	phase = state.startup.begin("renderer");
+	state.renderer = SDL_CreateRenderer(state.window, nullptr);
+	state.startup.end(phase);
+
+	if (!state.renderer)
+	{
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error creating renderer", state.window);
+		initSuccess = false;
+	}
+
+	state.gfx.setRenderer(state.renderer);
+	state.batch.setContext(&state.gfx);
+	updateFrameInterval(state);
+
+	// Configure presentation, the scene is drawn at logical resolution and upscaled once per frame
+	SDL_SetRenderVSync(state.renderer, 1);
+	state.sceneTarget = SDL_CreateTexture(state.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, state.logW, state.logH);
+
+	if (!state.sceneTarget)
+	{
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", "Error creating scene render target", state.window);
+		initSuccess = false;
+	}
+	SDL_SetTextureScaleMode(state.sceneTarget, SDL_SCALEMODE_NEAREST);
+
+	return initSuccess;
+}
 
 void cleanup(SDLState &state)
 {
-	SDL_DestroyRenderer(state.renderer);
-	SDL_DestroyWindow(state.window);
-	MIX_Quit();
-	SDL_Quit();
+	SDL_DestroyTexture(state.sceneTarget);
+	SDL_DestroyRenderer(state.renderer);
+	SDL_DestroyWindow(state.window);
+	MIX_Quit();
+	SDL_Quit();
+}
+
+// Draws the world into the current target: background, background tiles,
+// objects, bullets, particles and foreground tiles. With a profile, each pass
+// is flushed through the renderer and timed on its own.
+void drawScene(SDLState &state, GameState &gs, Resources &res, ScenePassStats *profile)
+{
+	SDL_FRect const view = gs.camera.view();
+	double const msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+	Uint64 passStart = profile ? SDL_GetPerformanceCounter() : 0;
+	int passCalls = state.gfx.frameStats().drawCalls;
+	auto const endPass = [&](ScenePass pass)
+	{
+		if (!profile)
+		{
+			return;
+		}
+		state.batch.flush();
+		SDL_FlushRenderer(state.renderer);
+		Uint64 const now = SDL_GetPerformanceCounter();
+		int const calls = state.gfx.frameStats().drawCalls;
+		profile->ms[static_cast<int>(pass)] += (now - passStart) * msPerCount;
+		profile->drawCalls[static_cast<int>(pass)] += calls - passCalls;
+		passStart = now;
+		passCalls = calls;
+	};
+
+	// Draw background images, the cached background is opaque so no clear is needed
+	res.background.setScroll(res.bgLayer4, gs.bg4Scroll);
+	res.background.setScroll(res.bgLayer3, gs.bg3Scroll);
+	res.background.setScroll(res.bgLayer2, gs.bg2Scroll);
+	res.background.setParallaxEnabled(!state.quality.atLeast(QualityLevel::noParallax));
+	res.background.draw(state.gfx);
+	endPass(ScenePass::background);
+
+	// Draw background tiles
+	for (GameObject &obj : gs.backgroundTiles)
+	{
+		if (!gs.camera.isVisible(SDL_FRect { obj.position.x, obj.position.y, TILE_SIZE, TILE_SIZE }))
+		{
+			continue;
+		}
+		SDL_FRect src {
+			.x = 0,
+			.y = 0,
+			.w = static_cast<float>(obj.texture->w),
+			.h = static_cast<float>(obj.texture->h),
+		};
+		SDL_FRect dst {
+			.x = obj.position.x - view.x,
+			.y = obj.position.y - view.y,
+			.w = src.w,
+			.h = src.h,
+		};
+		state.batch.draw(obj.texture, src, dst);
+	}
+	endPass(ScenePass::backgroundTiles);
+
+	// Draw all objects
+	for (auto &layer : gs.layers)
+	{
+		for (GameObject &obj : layer)
+		{
+			if (obj.type != ObjectType::level || !obj.data.level.destroyed)
+			{
+				drawObject(state, gs, obj, TILE_SIZE, TILE_SIZE);
+			}
+		}
+	}
+	endPass(ScenePass::objects);
+
+	// Draw bullets
+	for (GameObject &bullet : gs.bullets)
+	{
+		if (bullet.data.bullet.state != BulletState::inactive)
+		{
+			drawObject(state, gs, bullet, bullet.collider.w, bullet.collider.h);
+		}
+	}
+	endPass(ScenePass::bullets);
+
+	// Draw particles, one geometry call for all of them
+	state.batch.flush();
+	gs.particles.draw(state.gfx, view, PARTICLE_SIZE);
+	endPass(ScenePass::particles);
+
+	// Draw foreground tiles
+	for (GameObject &obj : gs.foregroundTiles)
+	{
+		if (!gs.camera.isVisible(SDL_FRect { obj.position.x, obj.position.y, TILE_SIZE, TILE_SIZE }))
+		{
+			continue;
+		}
+		SDL_FRect src {
+			.x = 0,
+			.y = 0,
+			.w = static_cast<float>(obj.texture->w),
+			.h = static_cast<float>(obj.texture->h),
+		};
+		SDL_FRect dst {
+			.x = obj.position.x - view.x,
+			.y = obj.position.y - view.y,
+			.w = src.w,
+			.h = src.h,
+		};
+		state.batch.draw(obj.texture, src, dst);
+	}
+	state.batch.flush();
+	endPass(ScenePass::foreground);
+}
+
+void drawObject(SDLState &state, GameState &gs, GameObject &obj, float width, float height)
+{
+	if (!gs.camera.isVisible(SDL_FRect { obj.position.x, obj.position.y, width, height }))
+	{
+		return;
+	}
+	SDL_FRect const view = gs.camera.view();
+
+	SDL_FRect src {
+		.x = 0,
+		.y = 0,
+		.w = width,
+		.h = height,
+	};
+
+	SDL_FRect dst {
+		.x = obj.position.x - view.x,
+		.y = obj.position.y - view.y,
+		.w = width,
+		.h = height,
+	};
+
+	SDL_FlipMode flipMode = obj.direction == -1 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+	SDL_Texture *texture = obj.texture;
+	if (obj.currentAnimation != -1)
+	{
+		// Frames come mirrored and placed relative to the bottom center of the
+		// object, sampled from the image of the clip
+		Animation const &anim = obj.animations[obj.currentAnimation];
+		SpriteFrame const &frame = anim.frame(obj.direction == -1);
+		texture = anim.getClip()->texture;
+		src = frame.src;
+		dst = SDL_FRect {
+			.x = dst.x + width / 2 + frame.dst.x,
+			.y = dst.y + height + frame.dst.y,
+			.w = frame.dst.w,
+			.h = frame.dst.h,
+		};
+		flipMode = SDL_FLIP_NONE;
+	}
+	if (!texture)
+	{
+		return;
+	}
+
+	// Flashing objects get a redish tint through their vertex color
+	SDL_FColor const tint = obj.shouldFlash
+		? SDL_FColor { 2.5f, 1.0f, 1.0f, 1.0f }
+		: SDL_FColor { 1.0f, 1.0f, 1.0f, 1.0f };
+	state.batch.draw(texture, src, dst, flipMode, tint);
+
+	if (gs.debugMode && !state.quality.atLeast(QualityLevel::noDebugOverlay))
+	{
+		SDL_FRect rectA {
+			.x = obj.position.x + obj.collider.x - view.x,
+			.y = obj.position.y + obj.collider.y - view.y,
+			.w = obj.collider.w,
+			.h = obj.collider.h,
+		};
+		SDL_FRect rectB {
+			.x = obj.position.x + obj.collider.x - view.x,
+			.y = obj.position.y + obj.collider.y + obj.collider.h - view.y,
+			.w = obj.collider.w,
+			.h = 1,
+		};
+		state.debug.fillRect(SDL_Color { 255, 0, 0, 150 }, rectA);
+		state.debug.fillRect(SDL_Color { 0, 0, 255, 150 }, rectB);
+	}
+}
+
+// Advances the whole simulation by one step
+void simulate(SDLState const &state, GameState &gs, Resources &res, float deltaTime)
+{
+	// Update dynamic objects within the active chunks, level tiles never move
+	buildBroadphase(gs, res.map.tileset);
+	gs.updateActiveChunks();
+	for (auto &layer : gs.layers)
+	{
+		for (GameObject &obj : layer)
+		{
+			if (obj.dynamic && gs.isActive(obj.position))
+			{
+				update(state, gs, res, obj, deltaTime);
+			}
+		}
+	}
+
+	// Update bullets
+	for (GameObject &bullet : gs.bullets)
+	{
+		update(state, gs, res, bullet, deltaTime);
+	}
+
+	// Particles are not restored by a rollback, replayed ticks must not move them again
+	if (!gs.silent)
+	{
+		gs.particles.update(deltaTime, GRAVITY);
+	}
+
+	// Scroll the parallax layers
+	float const playerVelX = gs.player().velocity.x;
+	updateParalaxBackground(res.background.getLayerWidth(res.bgLayer4), playerVelX, gs.bg4Scroll, 0.075f, deltaTime);
+	updateParalaxBackground(res.background.getLayerWidth(res.bgLayer3), playerVelX, gs.bg3Scroll, 0.15f, deltaTime);
+	updateParalaxBackground(res.background.getLayerWidth(res.bgLayer2), playerVelX, gs.bg2Scroll, 0.3f, deltaTime);
+
+	// Follow the player with the camera
+	gs.camera.follow(gs.focus());
+
+	// Tiles destroyed this tick leave the level grid and the shot grid
+	gs.commitTileChanges(res.map.tileset);
+}
+
+void update(SDLState const &state, GameState &gs, Resources &res, GameObject &obj, float deltaTime)
+{
+	// Update the animation. Enemies out of view only bank the elapsed time,
+	// distant ones in view step at a reduced rate under load. Checks on the
+	// clip add the banked time, see isDone(float).
+	if (obj.currentAnimation != -1)
+	{
+		Animation &anim = obj.animations[obj.currentAnimation];
+		obj.animDebt += deltaTime;
+		bool const enemy = obj.type == ObjectType::enemy;
+		if (enemy && !gs.camera.isVisible(SDL_FRect { obj.position.x, obj.position.y, TILE_SIZE, TILE_SIZE }, TILE_SIZE))
+		{
+			// Only the phase of a looping clip matters once it is seen again
+			if (anim.getClip()->loop)
+			{
+				obj.animDebt = SDL_fmodf(obj.animDebt, anim.getLength());
+			}
+		}
+		else
+		{
+			bool const reducedRate = enemy &&
+				state.quality.atLeast(QualityLevel::reducedAnimation) &&
+				glm::length(gs.focus() - obj.position) > ANIM_LOD_DISTANCE;
+			if (!reducedRate || obj.animDebt >= ANIM_LOD_INTERVAL)
+			{
+				anim.step(obj.animDebt);
+				obj.animDebt = 0;
+			}
+		}
+	}
+
+	// Update the hit flash
+	if (obj.shouldFlash && obj.flashTimer.step(deltaTime))
+	{
+		obj.shouldFlash = false;
+	}
+
+	// Apply some gravity
+	if (obj.dynamic && !obj.grounded)
+	{
+		obj.velocity += glm::vec2(0, GRAVITY) * deltaTime;
+	}
+
+	float currentDirection = 0;
+
+	if (obj.type == ObjectType::player)
+	{
+		float const JUMP_FORCE = -200.0f;
+		Uint8 const input = obj.data.player.input;
+		if (input & INPUT_LEFT)
+		{
+			currentDirection -= 1;
+		}
+		if (input & INPUT_RIGHT)
+		{
+			currentDirection += 1;
+		}
+		if ((input & INPUT_JUMP) && obj.data.player.state != PlayerState::jumping)
+		{
+			obj.data.player.state = PlayerState::jumping;
+			obj.velocity.y += JUMP_FORCE;
+		}
+
+		// Hitscan shots are cheap enough to fire much faster than bullets
+		if (input & INPUT_SWITCH_WEAPON)
+		{
+			bool const hitscan = obj.data.player.weapon == WeaponMode::bullets;
+			obj.data.player.weapon = hitscan ? WeaponMode::hitscan : WeaponMode::bullets;
+			obj.data.player.weaponTimer = Timer(hitscan ? HITSCAN_INTERVAL : BULLET_INTERVAL);
+		}
+
+		Timer &weaponTimer = obj.data.player.weaponTimer;
+		weaponTimer.step(deltaTime);
+
+		// Running and running while shooting are one cycle drawn from two
+		// sheets, the progress carries over when switching between them
+		auto const setAnimation = [&obj, &res](int index)
+		{
+			int const run = res.ANIM_PLAYER_RUN;
+			int const runShoot = res.ANIM_PLAYER_RUN_SHOOT;
+			if ((index == run && obj.currentAnimation == runShoot) || (index == runShoot && obj.currentAnimation == run))
+			{
+				Animation const &current = obj.animations[obj.currentAnimation];
+				obj.animations[index] = Animation(*obj.animations[index].getClip(), current.getTimer(), current.currentFrame());
+			}
+			obj.currentAnimation = index;
+		};
+
+		auto const handleShooting = [&state, &gs, &res, &obj, &weaponTimer, &setAnimation, input](
+			int animIndex, int shootAnimIndex)
+		{
+			if (input & INPUT_SHOOT)
+			{
+				setAnimation(shootAnimIndex);
+
+				// Under load the number of live bullets is capped
+				bool capped = false;
+				if (obj.data.player.weapon == WeaponMode::bullets && state.quality.atLeast(QualityLevel::cappedEffects))
+				{
+					auto const activeBullets = std::count_if(gs.bullets.begin(), gs.bullets.end(),
+						[](GameObject const &b) { return b.data.bullet.state != BulletState::inactive; });
+					capped = activeBullets >= MAX_BULLETS_CAPPED;
+				}
+
+				if (weaponTimer.isTimeout() && !capped)
+				{
+					weaponTimer.reset();
+
+					// Muzzle position
+					float const left = 4;
+					float const right = 24;
+					float const t = (obj.direction + 1) / 2.0f; // results in a value of 0..1
+					float const xOffset = left + right * t; // LERP between left and right based on direction
+					glm::vec2 const muzzle(
+						obj.position.x + xOffset,
+						obj.position.y + TILE_SIZE / 2 + 1
+					);
+
+					if (obj.data.player.weapon == WeaponMode::hitscan)
+					{
+						fireHitscan(state, gs, res, obj, muzzle);
+					}
+					else
+					{
+						// Spawn some bullets
+						GameObject bullet;
+						bullet.data.bullet = BulletData();
+						bullet.type = ObjectType::bullet;
+						bullet.direction = obj.direction;
+						bullet.currentAnimation = res.ANIM_BULLET_MOVING;
+						SDL_FRect const &frame = res.bulletAnims[res.ANIM_BULLET_MOVING].frame(false).dst;
+						bullet.collider = SDL_FRect {
+							.x = 0,
+							.y = 0,
+							.w = frame.w,
+							.h = frame.h,
+						};
+						int const yVariation = 40;
+						float const yVelocity = SDL_rand_r(&gs.rngState, yVariation) - yVariation / 2.0f;
+						bullet.velocity = glm::vec2(obj.velocity.x + 600.0f * obj.direction, yVelocity);
+						bullet.maxSpeedX = 1000.0f;
+						bullet.animations = res.bulletAnims;
+						bullet.position = muzzle;
+
+						// Look for an inactive slot and overwrite the bullet
+						bool foundInactive = false;
+						for (int i = 0; i < gs.bullets.size() && !foundInactive; i++)
+						{
+							if (gs.bullets[i].data.bullet.state == BulletState::inactive)
+							{
+								foundInactive = true;
+								gs.bullets[i] = bullet;
+							}
+						}
+
+						// If no inactive slot was found, push a new bullet
+						if (!foundInactive)
+						{
+							gs.bullets.push_back(bullet);
+						}
+					}
+
+					if (!gs.silent)
+					{
+						MIX_PlayTrack(res.trackShoot, 0);
+					}
+				}
+			}
+			else
+			{
+				setAnimation(animIndex);
+			}
+		};
+
+		switch (obj.data.player.state)
+		{
+			case PlayerState::idle:
+			{
+				// Switching to running state
+				if (currentDirection)
+				{
+					obj.data.player.state = PlayerState::running;
+				}
+				else
+				{
+					// Decelerate
+					if (obj.velocity.x)
+					{
+						float const factor = obj.velocity.x > 0 ? -1.5f : 1.5f;
+						float amount = factor * obj.acceleration.x * deltaTime;
+						if (std::abs(obj.velocity.x) < std::abs(amount))
+						{
+							obj.velocity.x = 0;
+						}
+						else
+						{
+							obj.velocity.x += amount;
+						}
+					}
+				}
+
+				handleShooting(res.ANIM_PLAYER_IDLE, res.ANIM_PLAYER_SHOOT);
+				break;
+			}
+			case PlayerState::running:
+			{
+				// Switching to idle state
+				if (!currentDirection)
+				{
+					obj.data.player.state = PlayerState::idle;
+				}
+
+				// Moving in opposite dirction of velocity, sliding!
+				if (obj.velocity.x * obj.direction < 0 && obj.grounded)
+				{
+					handleShooting(res.ANIM_PLAYER_SLIDE, res.ANIM_PLAYER_SLIDE_SHOOT);
+				}
+				else
+				{
+					handleShooting(res.ANIM_PLAYER_RUN, res.ANIM_PLAYER_RUN_SHOOT);
+				}
+				break;
+			}
+			case PlayerState::jumping:
+			{
+				handleShooting(res.ANIM_PLAYER_RUN, res.ANIM_PLAYER_RUN_SHOOT);
+				break;
+			}
+		}
+	}
+	else if (obj.type == ObjectType::bullet)
+	{
+		switch (obj.data.bullet.state)
+		{
+			case BulletState::moving:
+			{
+				SDL_FRect const view = gs.camera.view();
+				if (obj.position.x < view.x || // left edge
+					obj.position.x > view.x + view.w || // right edge
+					obj.position.y < view.y || // top edge
+					obj.position.y > view.y + view.h) // bottom edge
+				{
+					obj.data.bullet.state = BulletState::inactive;
+				}
+				break;
+			}
+			case BulletState::colliding:
+			{
+				if (obj.animations[obj.currentAnimation].isDone())
+				{
+					obj.data.bullet.state = BulletState::inactive;
+				}
+			}
+		}
+	}
+	else if (obj.type == ObjectType::enemy)
+	{
+		switch (obj.data.enemy.state)
+		{
+			case EnemyState::shambling:
+			{
+				glm::vec2 playerDir = gs.nearestPlayer(obj.position).position - obj.position;
+				if (glm::length(playerDir) < 100)
+				{
+					currentDirection = playerDir.x < 0 ? -1 : 1;
+					obj.acceleration = glm::vec2(30, 0);
+				}
+				else
+				{
+					obj.acceleration = glm::vec2(0);
+					obj.velocity.x = 0;
+				}
+				break;
+			}
+			case EnemyState::damaged:
+			{
+				if (obj.data.enemy.damagedTimer.step(deltaTime))
+				{
+					obj.data.enemy.state = EnemyState::shambling;
+					obj.currentAnimation = res.ANIM_ENEMY;
+					obj.animDebt = 0;
+				}
+				break;
+			}
+			case EnemyState::dead:
+			{
+				// The death clip does not loop and stays on its last frame. Once it
+				// has played out, counting banked time, it is settled on that frame
+				// even when out of view.
+				obj.velocity.x = 0;
+				Animation &anim = obj.animations[obj.currentAnimation];
+				if (obj.animDebt > 0 && anim.isDone(obj.animDebt))
+				{
+					anim.step(obj.animDebt);
+					obj.animDebt = 0;
+				}
+			}
+		}
+	}
+
+	if (currentDirection)
+	{
+		obj.direction = currentDirection;
+	}
+
+	// Add acceleration to velocity
+	obj.velocity += currentDirection * obj.acceleration * deltaTime;
+	if (std::abs(obj.velocity.x) > obj.maxSpeedX)
+	{
+		obj.velocity.x = currentDirection * obj.maxSpeedX;
+	}
+
+	// Add velocity to position
+	obj.position += obj.velocity * deltaTime;
+
+	// Handle collision detection against nearby objects from the broadphase,
+	// padded as the grid was built from positions at the start of the tick
+	float const margin = TILE_SIZE / 2.0f;
+	SDL_FRect const queryRect {
+		.x = obj.position.x + obj.collider.x - margin,
+		.y = obj.position.y + obj.collider.y - margin,
+		.w = obj.collider.w + margin * 2,
+		.h = obj.collider.h + margin * 2 + 1,
+	};
+	gs.levelGrid.query(queryRect, gs.candidates);
+	gs.grid.query(queryRect, gs.candidates, true);
+
+	bool foundGround = false;
+	for (ObjectRef const &ref : gs.candidates)
+	{
+		GameObject &objB = gs.layers[ref.layer][ref.index];
+		// Tiles destroyed earlier in this tick stay binned until the commit
+		if (&obj != &objB && !(objB.type == ObjectType::level && objB.data.level.destroyed))
+		{
+			checkCollisions(state, gs, res, obj, objB, deltaTime);
+
+			if (objB.type == ObjectType::level)
+			{
+				// Grounded sensor
+				SDL_FRect sensor {
+					.x = obj.position.x + obj.collider.x,
+					.y = obj.position.y + obj.collider.y + obj.collider.h,
+					.w = obj.collider.w,
+					.h = 1,
+				};
+
+				SDL_FRect rectB {
+					.x = objB.position.x + objB.collider.x,
+					.y = objB.position.y + objB.collider.y,
+					.w = objB.collider.w,
+					.h = objB.collider.h,
+				};
+
+				SDL_FRect rectC { 0 };
+
+				// Only the top edge of a one-way platform supports
+				bool const oneWay = res.map.tileset.getFlags(objB.data.level.tile) & TILE_ONE_WAY;
+				if (SDL_GetRectIntersectionFloat(&sensor, &rectB, &rectC) && (!oneWay || sensor.y <= rectB.y + 1))
+				{
+					foundGround = true;
+				}
+			}
+		}
+	}
+
+	if (obj.grounded != foundGround)
+	{
+		// Switching grounded state
+		obj.grounded = foundGround;
+		if (foundGround && obj.type == ObjectType::player)
+		{
+			obj.data.player.state = PlayerState::idle;
+		}
+	}
+}
+
+void collisionResponse(SDLState const &state, GameState &gs, Resources &res,
+	SDL_FRect &rectA, SDL_FRect &rectB, SDL_FRect &rectC,
+	GameObject &objA, GameObject &objB, float deltaTime)
+{
+	auto const genericResponse = [&]()
+	{
+		if (rectC.w < rectC.h)
+		{
+			// Horizontal collision
+			if (objA.velocity.x > 0)
+			{
+				objA.position.x -= rectC.w; // going right
+			}
+			else if (objA.velocity.x < 0)
+			{
+				objA.position.x += rectC.w; // going left
+			}
+			objA.velocity.x = 0;
+		}
+		else
+		{
+			// Vertical collision
+			if (objA.velocity.y > 0)
+			{
+				objA.position.y -= rectC.h; // going down
+			}
+			else if (objA.velocity.y < 0)
+			{
+				objA.position.y += rectC.h; // going up
+			}
+			objA.velocity.y = 0;
+		}
+	};
+
+	// One-way platforms only stop objects that were above them before this step
+	if (objB.type == ObjectType::level && (res.map.tileset.getFlags(objB.data.level.tile) & TILE_ONE_WAY))
+	{
+		float const prevBottom = rectA.y + rectA.h - objA.velocity.y * deltaTime;
+		if (objA.velocity.y <= 0 || prevBottom > rectB.y + 1)
+		{
+			return;
+		}
+	}
+
+	// Object we are checking
+	if (objA.type == ObjectType::player)
+	{
+		// Object it is colliding with
+		switch (objB.type)
+		{
+			case ObjectType::level:
+			{
+				genericResponse();
+				break;
+			}
+			case ObjectType::enemy:
+			{
+				if (objB.data.enemy.state != EnemyState::dead)
+				{
+					objA.velocity = glm::vec2(100, 0) * -objA.direction;
+				}
+				break;
+			}
+		}
+	}
+	else if (objA.type == ObjectType::bullet)
+	{
+		bool passthrough = false;
+		switch (objA.data.bullet.state)
+		{
+			case BulletState::moving:
+			{
+				switch (objB.type)
+				{
+					case ObjectType::level:
+					{
+						if (!gs.silent)
+						{
+							MIX_SetTrackGain(res.trackShootHit, SFX_GAIN * gs.camera.audibility(objA.position));
+							MIX_PlayTrack(res.trackShootHit, 0);
+						}
+						emitParticles(state, gs, BURST_SPARKS, objA.position + glm::vec2(rectA.w / 2, rectA.h / 2),
+							objA.direction > 0 ? SDL_PI_F : 0, 24);
+						damageTile(state, gs, static_cast<int>(&objB - gs.layers[LAYER_IDX_LEVEL].data()));
+						break;
+					}
+					case ObjectType::enemy:
+					{
+						if (objB.data.enemy.state != EnemyState::dead)
+						{
+							damageEnemy(state, gs, res, objB, objA.direction);
+						}
+						else
+						{
+							// Don't collide with dead enemies
+							passthrough = true;
+						}
+						break;
+					}
+				}
+				if (!passthrough)
+				{
+					genericResponse();
+					objA.velocity *= 0;
+					objA.data.bullet.state = BulletState::colliding;
+					objA.currentAnimation = res.ANIM_BULLET_HIT;
+				}
+				break;
+			}
+		}
+	}
+	else if (objA.type == ObjectType::enemy)
+	{
+		genericResponse();
+	}
+}
+
+// Bursts point along angle, they are cut down under load
+void emitParticles(SDLState const &state, GameState &gs, ParticleBurst const &burst, glm::vec2 pos, float angle, int count)
+{
+	if (gs.silent)
+	{
+		return;
+	}
+	if (state.quality.atLeast(QualityLevel::cappedEffects))
+	{
+		count /= 4;
+	}
+	ParticleBurst aimed = burst;
+	aimed.angle += angle;
+	gs.particles.emit(aimed, pos, count);
+}
+
+// A hit from a shot travelling in direction, by a bullet or a hitscan ray
+void damageEnemy(SDLState const &state, GameState &gs, Resources &res, GameObject &enemy, float direction)
+{
+	EnemyData &d = enemy.data.enemy;
+	enemy.direction = -direction;
+	enemy.shouldFlash = true;
+	enemy.flashTimer.reset();
+	enemy.currentAnimation = res.ANIM_ENEMY_HIT;
+	enemy.animDebt = 0; // banked for the clip it left
+	d.state = EnemyState::damaged;
+	// Damage the enemy and flag dead if needed
+	d.healthPoints -= SHOT_DAMAGE;
+	glm::vec2 const center = enemy.position + glm::vec2(TILE_SIZE / 2);
+	if (d.healthPoints <= 0)
+	{
+		d.state = EnemyState::dead;
+		enemy.currentAnimation = res.ANIM_ENEMY_DIE;
+		emitParticles(state, gs, BURST_ENEMY_DEATH, center, 0, 160);
+	}
+	else
+	{
+		emitParticles(state, gs, BURST_ENEMY_HIT, center, direction > 0 ? 0 : SDL_PI_F, 32);
+	}
+	if (!gs.silent)
+	{
+		MIX_SetTrackGain(res.trackEnemyHit, SFX_GAIN * gs.camera.audibility(enemy.position));
+		MIX_PlayTrack(res.trackEnemyHit, 0);
+	}
+}
+
+// A shot hitting a level tile, breakable ones fall apart once out of health
+void damageTile(SDLState const &state, GameState &gs, int index)
+{
+	if (gs.damageTile(index, SHOT_DAMAGE))
+	{
+		glm::vec2 const center = gs.layers[LAYER_IDX_LEVEL][index].position + glm::vec2(TILE_SIZE / 2);
+		emitParticles(state, gs, BURST_DEBRIS, center, 0, 48);
+	}
+}
+
+// Casts the shot through the tile grid cell by cell. Only the enemies binned
+// in the broadphase cells the ray crosses are tested, and the walk stops at
+// the first solid tile or once the nearest hit lies behind the current cell.
+void fireHitscan(SDLState const &state, GameState &gs, Resources &res, GameObject &shooter, glm::vec2 muzzle)
+{
+	glm::vec2 const dir(shooter.direction, 0);
+	glm::vec2 const origin(gs.mapBounds.x, gs.mapBounds.y);
+	int const tilesPerCell = GRID_CELL_SIZE / TILE_SIZE;
+	float hitT = HITSCAN_RANGE;
+	GameObject *target = nullptr;
+	int wallTile = -1;
+	bool wall = false;
+	int lastCell = -1;
+	traverseGrid(muzzle - origin, dir, HITSCAN_RANGE, TILE_SIZE, gs.tileCols, gs.tileRows,
+		[&](int col, int row, float tEnter, float tExit)
+	{
+		int const gridCol = col / tilesPerCell;
+		int const gridRow = row / tilesPerCell;
+		int const cell = gridRow * gs.grid.getCols() + gridCol;
+		if (cell != lastCell)
+		{
+			lastCell = cell;
+			for (ObjectRef const &ref : gs.grid.cellItems(gridCol, gridRow))
+			{
+				GameObject &obj = gs.layers[ref.layer][ref.index];
+				if (obj.type != ObjectType::enemy || obj.data.enemy.state == EnemyState::dead)
+				{
+					continue;
+				}
+				SDL_FRect const rect {
+					.x = obj.position.x + obj.collider.x,
+					.y = obj.position.y + obj.collider.y,
+					.w = obj.collider.w,
+					.h = obj.collider.h,
+				};
+				float const t = rayRect(muzzle, dir, rect, hitT);
+				if (t >= 0 && t < hitT)
+				{
+					hitT = t;
+					target = &obj;
+				}
+			}
+		}
+		// solidTiles only catches up at the end of the tick, so tiles shot
+		// away earlier in this tick are skipped like in the collision loop
+		int const tile = gs.tileIndex[row * gs.tileCols + col];
+		if (gs.solidTiles[row * gs.tileCols + col] && tEnter < hitT &&
+			!(tile >= 0 && gs.layers[LAYER_IDX_LEVEL][tile].data.level.destroyed))
+		{
+			hitT = tEnter;
+			target = nullptr;
+			wall = true;
+			wallTile = tile;
+			return false;
+		}
+		return hitT > tExit;
+	});
+
+	glm::vec2 const impact = muzzle + dir * hitT;
+	if (target)
+	{
+		damageEnemy(state, gs, res, *target, shooter.direction);
+	}
+	else if (wall)
+	{
+		if (!gs.silent)
+		{
+			MIX_SetTrackGain(res.trackShootHit, SFX_GAIN * gs.camera.audibility(impact));
+			MIX_PlayTrack(res.trackShootHit, 0);
+		}
+		emitParticles(state, gs, BURST_SPARKS, impact, shooter.direction > 0 ? SDL_PI_F : 0, 12);
+		if (wallTile != -1)
+		{
+			damageTile(state, gs, wallTile);
+		}
+	}
+
+	// Tracer, a line of short lived particles
+	if (!gs.silent)
+	{
+		for (float d = 0; d < hitT; d += TRACER_SPACING)
+		{
+			gs.particles.emit(BURST_TRACER, muzzle + dir * d, 1);
+		}
+	}
+}
+
+void checkCollisions(SDLState const &state, GameState &gs, Resources &res,
+	GameObject &a, GameObject &b, float deltaTime)
+{
+	SDL_FRect rectA {
+		.x = a.position.x + a.collider.x,
+		.y = a.position.y + a.collider.y,
+		.w = a.collider.w,
+		.h = a.collider.h,
+	};
+
+	SDL_FRect rectB {
+		.x = b.position.x + b.collider.x,
+		.y = b.position.y + b.collider.y,
+		.w = b.collider.w,
+		.h = b.collider.h,
+	};
+
+	SDL_FRect rectC { 0 };
+
+	if (SDL_GetRectIntersectionFloat(&rectA, &rectB, &rectC))
+	{
+		// Found intersection, respond accordingly
+		collisionResponse(state, gs, res, rectA, rectB, rectC, a, b, deltaTime);
+	}
+}
+
+void createTiles(SDLState const &state, GameState &gs, Resources &res)
+{
+	TileMap const &map = res.map;
+	Uint8 const *tileFlags = map.tileset.getFlagTable();
+
+	auto const createObject = [&map](float x, float y, SDL_Texture *tex, ObjectType type)
+	{
+		GameObject o;
+		o.type = type;
+		o.position = glm::vec2(x, y);
+		o.texture = tex;
+		o.collider = {
+			.x = 0,
+			.y = 0,
+			.w = static_cast<float>(map.tileWidth),
+			.h = static_cast<float>(map.tileHeight),
+		};
+		return o;
+	};
+
+	// Characters are placed centered on their spawn point
+	auto const spawn = [&gs, &res, &createObject](std::string const &kind, glm::vec2 center)
+	{
+		glm::vec2 const pos = center - glm::vec2(TILE_SIZE / 2);
+		if (SDL_strcasecmp(kind.c_str(), "enemy") == 0)
+		{
+			GameObject o = createObject(pos.x, pos.y, nullptr, ObjectType::enemy);
+			o.data.enemy = EnemyData();
+			o.currentAnimation = res.ANIM_ENEMY;
+			o.animations = res.enemyAnims;
+			o.collider = SDL_FRect { .x = 10, .y = 4, .w = 12, .h = 28 };
+			o.maxSpeedX = 15;
+			o.dynamic = true;
+			gs.layers[LAYER_IDX_CHARACTERS].push_back(o);
+			return true;
+		}
+		if (SDL_strcasecmp(kind.c_str(), "player") == 0)
+		{
+			GameObject player = createObject(pos.x, pos.y, nullptr, ObjectType::player);
+			player.data.player = PlayerData();
+			player.animations = res.playerAnims;
+			player.currentAnimation = res.ANIM_PLAYER_IDLE;
+			player.acceleration = glm::vec2(300, 0);
+			player.maxSpeedX = 100;
+			player.dynamic = true;
+			player.collider = { .x = 11, .y = 6, .w = 10, .h = 26 };
+			gs.layers[LAYER_IDX_CHARACTERS].push_back(player);
+			gs.playerIndex = gs.layers[LAYER_IDX_CHARACTERS].size() - 1;
+			return true;
+		}
+		return false;
+	};
+
+	for (TileLayer const &layer : map.layers)
+	{
+		for (int r = 0; r < map.height; r++)
+		{
+			for (int c = 0; c < map.width; c++)
+			{
+				Uint32 const gid = layer.tiles[r * map.width + c] & TILE_GID_MASK;
+				if (gid == 0 || gid >= static_cast<Uint32>(map.tileset.getCount()))
+				{
+					continue;
+				}
+				Uint8 const flags = tileFlags[gid];
+				float const x = static_cast<float>(c * map.tileWidth);
+				float const y = static_cast<float>(r * map.tileHeight);
+				if (flags & TILE_SPAWN)
+				{
+					spawn(map.tileset.getSpawn(gid), glm::vec2(x + map.tileWidth / 2.0f, y + map.tileHeight / 2.0f));
+					continue;
+				}
+
+				GameObject o = createObject(x, y, res.tileTextures[gid], ObjectType::level);
+				o.data.level.tile = gid;
+				o.data.level.healthPoints = (flags & TILE_BREAKABLE) ? TILE_HEALTH : 0;
+				if (layer.role == LayerRole::background)
+				{
+					gs.backgroundTiles.push_back(o);
+				}
+				else if (layer.role == LayerRole::foreground || (flags & TILE_FOREGROUND))
+				{
+					gs.foregroundTiles.push_back(o);
+				}
+				else if (flags & (TILE_SOLID | TILE_ONE_WAY))
+				{
+					gs.layers[LAYER_IDX_LEVEL].push_back(o);
+				}
+				else
+				{
+					// Decoration placed in the level layer
+					gs.backgroundTiles.push_back(o);
+				}
+			}
+		}
+	}
+
+	for (MapObject const &object : map.objects)
+	{
+		glm::vec2 const point(object.x, object.y);
+		if (object.gid)
+		{
+			// Tile objects are anchored at their bottom-left corner
+			if (map.tileset.getFlags(object.gid) & TILE_SPAWN)
+			{
+				spawn(map.tileset.getSpawn(object.gid), point + glm::vec2(map.tileWidth / 2.0f, -map.tileHeight / 2.0f));
+			}
+		}
+		else if (!spawn(object.type, point) && !spawn(object.name, point))
+		{
+			SDL_Log("Map: object %s of unknown type %s", object.name.c_str(), object.type.c_str());
+		}
+	}
+
+	assert(gs.playerIndex != -1);
+	gs.levelGridValid = false;
+}
+
+// Second player of a net session, next to the first one
+void addRival(GameState &gs)
+{
+	GameObject rival = gs.player();
+	rival.position.x += TILE_SIZE;
+	rival.direction = -1;
+	gs.layers[LAYER_IDX_CHARACTERS].push_back(rival);
+	gs.rivalIndex = gs.layers[LAYER_IDX_CHARACTERS].size() - 1;
+}
+
+// Key presses are latched until the next simulation tick consumes them,
+// their event timestamps go along for latency measurement
+void handleKeyInput(SDLState &state, SDL_KeyboardEvent const &key)
+{
+	if (!key.down || key.repeat)
+	{
+		return;
+	}
+	switch (key.scancode)
+	{
+		case SDL_SCANCODE_K:
+		{
+			state.pressedButtons |= INPUT_JUMP;
+			state.latency.record(key.timestamp);
+			break;
+		}
+		case SDL_SCANCODE_L:
+		{
+			state.pressedButtons |= INPUT_SWITCH_WEAPON;
+			break;
+		}
+		case SDL_SCANCODE_A:
+		case SDL_SCANCODE_D:
+		case SDL_SCANCODE_J:
+		{
+			state.latency.record(key.timestamp);
+			break;
+		}
+	}
 }
 
-void drawObject(SDLState const &state, GameState &gs, GameObject &obj, float width, float height, float deltaTime)
+Uint8 sampleInput(SDLState &state)
 {
-	float srcX = obj.currentAnimation != -1
-		? obj.animations[obj.currentAnimation].currentFrame() * width
-		: (obj.spriteFrame - 1) * width;
-	;
+	Uint8 input = state.pressedButtons;
+	if (state.keys[SDL_SCANCODE_A])
+	{
+		input |= INPUT_LEFT;
+	}
+	if (state.keys[SDL_SCANCODE_D])
+	{
+		input |= INPUT_RIGHT;
+	}
+	if (state.keys[SDL_SCANCODE_J])
+	{
+		input |= INPUT_SHOOT;
+	}
+	return input;
+}
 
-	SDL_FRect src {
-		.x = srcX,
-		.y = 0,
-		.w = width,
-		.h = height,
-	};
+void updateParalaxBackground(float width, float xVelocity, float &scrollPos, float scrollFactor, float deltaTime)
+{
+	// Wrap in both directions to keep the position within (-width, 0]
+	scrollPos = SDL_fmodf(scrollPos - xVelocity * scrollFactor * deltaTime, width);
+	if (scrollPos > 0)
+	{
+		scrollPos -= width;
+	}
+}
+
+void updateFrameInterval(SDLState &state)
+{
+	SDL_DisplayMode const *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(state.window));
+	state.frameInterval = mode && mode->refresh_rate > 0 ? 1.0f / mode->refresh_rate : 1.0f / 60.0f;
+}
+
+// Sleeps through the part of the frame the recent frames' work does not need,
+// so input is polled and simulated just before the next vblank
+void waitForLateInput(SDLState const &state, Uint64 presentedAt)
+{
+	float const slack = state.frameInterval - state.quality.getWorkTime() - LATE_INPUT_MARGIN;
+	Uint64 const wakeAt = presentedAt + static_cast<Uint64>(std::max(slack, 0.0f) * 1e9f);
+	Uint64 const now = SDL_GetTicksNS();
+	if (now < wakeAt)
+	{
+		SDL_DelayPrecise(wakeAt - now);
+	}
+}
+
+void blitScene(SDLState &state)
+{
+	state.gfx.setTarget(nullptr);
+	state.gfx.setDrawColor(0, 0, 0, 255);
+	state.gfx.clear();
+
+	int outW = 0, outH = 0;
+	SDL_GetCurrentRenderOutputSize(state.renderer, &outW, &outH);
+
+	// Largest scale that fits, snapped to whole pixels when integer scaling is on
+	float scale = std::min(static_cast<float>(outW) / state.logW, static_cast<float>(outH) / state.logH);
+	if (state.integerScale && scale >= 1.0f)
+	{
+		scale = SDL_floorf(scale);
+	}
 
 	SDL_FRect dst {
-		.x = obj.position.x - gs.mapViewport.x,
-		.y = obj.position.y,
-		.w = width,
-		.h = height,
+		.w = state.logW * scale,
+		.h = state.logH * scale,
 	};
+	dst.x = SDL_floorf((outW - dst.w) / 2);
+	dst.y = SDL_floorf((outH - dst.h) / 2);
 
-	SDL_FlipMode flipMode = obj.direction == -1 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
-	if (!obj.shouldFlash)
+	// At low resolution only the top-left quarter of the target holds the scene
+	float const srcScale = state.quality.atLeast(QualityLevel::lowResolution) ? 0.5f : 1.0f;
+	SDL_FRect const src {
+		.x = 0,
+		.y = 0,
+		.w = state.logW * srcScale,
+		.h = state.logH * srcScale,
+	};
+	state.gfx.renderTexture(state.sceneTarget, &src, &dst);
+	state.sceneRect = dst;
+	state.sceneScale = scale;
+}
+
+void drawHud(SDLState &state, GameState &gs, Resources &res, RollbackSession const &net)
+{
+	// Drawn at the scene's scale directly into the window
+	float const x = state.sceneRect.x / state.sceneScale + 5;
+	float const y = state.sceneRect.y / state.sceneScale + 5;
+	state.gfx.setScale(state.sceneScale);
+
+	RenderStats const &stats = state.gfx.stats();
+	state.gfx.setDrawColor(255, 255, 255, 255);
+	state.gfx.debugText(x, y, std::format(
+		"S: {}, W: {}, B: {}, G: {}, PT: {} / {}",
+		static_cast<int>(gs.player().data.player.state),
+		gs.player().data.player.weapon == WeaponMode::hitscan ? "hitscan" : "bullets",
+		gs.bullets.size(),
+		gs.player().grounded,
+		gs.particles.getDrawn(),
+		gs.particles.getUsed()
+	).c_str());
+	state.gfx.debugText(x, y + 10, std::format(
+		"DC: {}, SC: {} ({} skipped), P: {}",
+		stats.drawCalls,
+		stats.stateChanges,
+		stats.skippedChanges,
+		stats.primitives
+	).c_str());
+	state.gfx.debugText(x, y + 20, std::format(
+		"Q: {}{}, work: {:.2f} ms",
+		QualityGovernor::levelName(state.quality.getLevel()),
+		state.quality.isEnabled() ? "" : " (off)",
+		state.quality.getWorkTime() * 1000.0f
+	).c_str());
+	state.gfx.debugText(x, y + 30, std::format(
+		"RC: {:.1f} / {} MiB, {} entries, {} evicted",
+		res.cache.getTotalBytes() / (1024.0 * 1024.0),
+		res.cache.getBudget() / (1024 * 1024),
+		res.cache.getEntryCount(),
+		res.cache.getEvictions()
+	).c_str());
+	if (state.capture.isRunning())
 	{
-		SDL_RenderTextureRotated(state.renderer, obj.texture, &src, &dst, 0, nullptr, flipMode);
+		state.gfx.debugText(x, y + 40, std::format(
+			"CAP: {} written, {} dropped, {:.3f} ms/frame",
+			state.capture.getWritten(),
+			state.capture.getDropped(),
+			state.capture.getAverageCost() * 1000.0
+		).c_str());
 	}
-	else
+	if (net.isOpen())
+	{
+		state.gfx.debugText(x, y + 50, std::format(
+			"NET: P{} tick {}, {} predicted, {} rollbacks ({} ticks, last {}), {:.2f} ms",
+			net.getLocalPlayer() + 1,
+			net.getTick(),
+			net.getPredictedTicks(),
+			net.getRollbacks(),
+			net.getResimulatedTicks(),
+			net.getLastDepth(),
+			net.getRollbackTime() * 1000.0f
+		).c_str());
+	}
+	if (state.latency.isEnabled())
 	{
-		// Flash object with a redish tint
-		SDL_SetTextureColorModFloat(obj.texture, 2.5f, 1.0f, 1.0f);
-		SDL_RenderTextureRotated(state.renderer, obj.texture, &src, &dst, 0, nullptr, flipMode);
-		SDL_SetTextureColorModFloat(obj.texture, 1.0f, 1.0f, 1.0f);
+		state.gfx.debugText(x, y + 60, std::format(
+			"LAT: avg {:.1f} ms, max {:.1f} ms{}",
+			state.latency.getAverage(),
+			state.latency.getWorst(),
+			state.lateInput ? ", late input" : ""
+		).c_str());
+	}
 
-		if (obj.flashTimer.step(deltaTime))
-		{
-			obj.shouldFlash = false;
-		}
+	state.gfx.setScale(1.0f);
+}
+
+void buildBroadphase(GameState &gs, Tileset const &tileset)
+{
+	// Level tiles never move and only change through tile mutations, which
+	// are committed at the end of a tick or here after a restore. Only the
+	// characters are binned every tick.
+	if (!gs.levelGridValid)
+	{
+		gs.rebuildLevel(tileset);
+	}
+	else
+	{
+		gs.commitTileChanges(tileset);
 	}
 
-	if (gs.debugMode)
+	gs.grid.clear();
+	for (int i = 0; i < gs.layers[LAYER_IDX_CHARACTERS].size(); i++)
 	{
-		SDL_FRect rectA {
-			.x = obj.position.x + obj.collider.x - gs.mapViewport.x,
+		GameObject const &obj = gs.layers[LAYER_IDX_CHARACTERS][i];
+		SDL_FRect const bounds {
+			.x = obj.position.x + obj.collider.x,
 			.y = obj.position.y + obj.collider.y,
 			.w = obj.collider.w,
 			.h = obj.collider.h,
 		};
-		SDL_FRect rectB {
-			.x = obj.position.x + obj.collider.x - gs.mapViewport.x,
-			.y = obj.position.y + obj.collider.y + obj.collider.h,
-			.w = obj.collider.w,
-			.h = 1,
-		};
-		SDL_SetRenderDrawBlendMode(state.renderer, SDL_BLENDMODE_BLEND);
-		SDL_SetRenderDrawColor(state.renderer, 255, 0, 0, 150);
-		SDL_RenderFillRect(state.renderer, &rectA);
-		SDL_SetRenderDrawColor(state.renderer, 0, 0, 255, 150);
-		SDL_RenderFillRect(state.renderer, &rectB);
-		SDL_SetRenderDrawBlendMode(state.renderer, SDL_BLENDMODE_NONE);
+		gs.grid.insert(ObjectRef { LAYER_IDX_CHARACTERS, i }, bounds);
 	}
+	gs.grid.build();
 }
 
-void update(SDLState const &state, GameState &gs, Resources &res, GameObject &obj, float deltaTime)
+void drawDebugOverlay(SDLState &state, GameState &gs)
 {
-	// Update the animation
-	if (obj.currentAnimation != -1)
+	SDL_FRect const view = gs.camera.view();
+	float const cellSize = gs.grid.getCellSize();
+	SDL_FRect const origin = gs.grid.cellRect(0, 0);
+
+	// Broadphase cells shaded by occupancy to spot hotspots
+	SDL_Color const occupancyColors[] = {
+		SDL_Color { 0, 255, 0, 40 },
+		SDL_Color { 255, 255, 0, 60 },
+		SDL_Color { 255, 128, 0, 80 },
+		SDL_Color { 255, 0, 0, 100 },
+	};
+	for (int r = 0; r < gs.grid.getRows(); r++)
 	{
-		obj.animations[obj.currentAnimation].step(deltaTime);
+		for (int c = 0; c < gs.grid.getCols(); c++)
+		{
+			int const count = gs.levelGrid.cellCount(c, r) + gs.grid.cellCount(c, r);
+			if (count == 0)
+			{
+				continue;
+			}
+
+			SDL_FRect cell = gs.grid.cellRect(c, r);
+			if (!gs.camera.isVisible(cell))
+			{
+				continue;
+			}
+			cell.x -= view.x;
+			cell.y -= view.y;
+			state.debug.fillRect(occupancyColors[std::min(count / 2, 3)], cell);
+		}
 	}
+	state.debug.grid(SDL_Color { 255, 255, 255, 40 },
+		origin.x - view.x, origin.y - view.y,
+		cellSize, cellSize, gs.grid.getCols(), gs.grid.getRows());
 
-	// Apply some gravity
-	if (obj.dynamic && !obj.grounded)
+	// Active chunks
+	for (int r = gs.activeChunks.y; r < gs.activeChunks.y + gs.activeChunks.h; r++)
 	{
-		obj.velocity += glm::vec2(0, 500) * deltaTime;
+		for (int c = gs.activeChunks.x; c < gs.activeChunks.x + gs.activeChunks.w; c++)
+		{
+			state.debug.rect(SDL_Color { 0, 255, 255, 120 }, SDL_FRect {
+				.x = gs.mapBounds.x + c * CHUNK_SIZE - view.x,
+				.y = gs.mapBounds.y + r * CHUNK_SIZE - view.y,
+				.w = CHUNK_SIZE,
+				.h = CHUNK_SIZE,
+			});
+		}
 	}
+	state.debug.flush(state.gfx);
 
-	float currentDirection = 0;
-
-	if (obj.type == ObjectType::player)
+	// Occupancy counts of the visible cells
+	state.gfx.setDrawColor(255, 255, 255, 255);
+	for (int r = 0; r < gs.grid.getRows(); r++)
 	{
-		if (state.keys[SDL_SCANCODE_A])
+		for (int c = 0; c < gs.grid.getCols(); c++)
 		{
-			currentDirection -= 1;
+			SDL_FRect const cell = gs.grid.cellRect(c, r);
+			int const count = gs.levelGrid.cellCount(c, r) + gs.grid.cellCount(c, r);
+			if (count > 0 && gs.camera.isVisible(cell))
+			{
+				state.gfx.debugText(cell.x - view.x + 2, cell.y - view.y + 2, std::to_string(count).c_str());
+			}
 		}
-		if (state.keys[SDL_SCANCODE_D])
+	}
+}
+
+// Swaps in the reloaded assets, true when the map or the clips changed.
+// Those are skipped unless levelReloads is set.
+bool applyReloads(SDLState &state, GameState &gs, Resources &res, std::vector<ReloadedAsset> &assets, bool levelReloads)
+{
+	bool levelChanged = false;
+	for (ReloadedAsset &asset : assets)
+	{
+		uint64_t const begin = SDL_GetPerformanceCounter();
+		if ((asset.map || asset.sprites) && !levelReloads)
 		{
-			currentDirection += 1;
+			SDL_Log("Reload: %s skipped during a net session", asset.path.c_str());
+			continue;
 		}
-
-		Timer &weaponTimer = obj.data.player.weaponTimer;
-		weaponTimer.step(deltaTime);
-
-		auto const handleShooting = [&state, &gs, &res, &obj, &weaponTimer](
-			SDL_Texture *tex, SDL_Texture *shootTex, int animIndex, int shootAnimIndex)
+		if (asset.surface)
 		{
-			if (state.keys[SDL_SCANCODE_J])
+			SDL_Texture *oldTex = res.cache.findTexture(asset.path);
+			if (!oldTex)
 			{
-				// Set shooting tex/anim
-				obj.texture = shootTex;
-				obj.currentAnimation = shootAnimIndex;
+				SDL_DestroySurface(asset.surface);
+				continue;
+			}
 
-				if (weaponTimer.isTimeout())
+			if (asset.surface->w == oldTex->w && asset.surface->h == oldTex->h)
+			{
+				// Same size, upload in place so every holder of the pointer sees it
+				SDL_Surface *converted = SDL_ConvertSurface(asset.surface, oldTex->format);
+				if (converted)
 				{
-					weaponTimer.reset();
-					// Spawn some bullets
-					GameObject bullet;
-					bullet.data.bullet = BulletData();
-					bullet.type = ObjectType::bullet;
-					bullet.direction = gs.player().direction;
-					bullet.texture = res.texBullet;
-					bullet.currentAnimation = res.ANIM_BULLET_MOVING;
-					bullet.collider = SDL_FRect {
-						.x = 0,
-						.y = 0,
-						.w = static_cast<float>(res.texBullet->h),
-						.h = static_cast<float>(res.texBullet->h),
-					};
-					int const yVariation = 40;
-					float const yVelocity = SDL_rand(yVariation) - yVariation / 2.0f;
-					bullet.velocity = glm::vec2(obj.velocity.x + 600.0f * obj.direction, yVelocity);
-					bullet.maxSpeedX = 1000.0f;
-					bullet.animations = res.bulletAnims;
-
-					// Adjust bullet start position
-					float const left = 4;
-					float const right = 24;
-					float const t = (obj.direction + 1) / 2.0f; // results in a value of 0..1
-					float const xOffset = left + right * t; // LERP between left and right based on direction
-					bullet.position = glm::vec2(
-						obj.position.x + xOffset,
-						obj.position.y + TILE_SIZE / 2 + 1
-					);
-
-					// Look for an inactive slot and overwrite the bullet
-					bool foundInactive = false;
-					for (int i = 0; i < gs.bullets.size() && !foundInactive; i++)
-					{
-						if (gs.bullets[i].data.bullet.state == BulletState::inactive)
-						{
-							foundInactive = true;
-							gs.bullets[i] = bullet;
-						}
-					}
-
-					// If no inactive slot was found, push a new bullet
-					if (!foundInactive)
-					{
-						gs.bullets.push_back(bullet);
-					}
-
-					MIX_PlayTrack(res.trackShoot, 0);
+					SDL_UpdateTexture(oldTex, nullptr, converted->pixels, converted->pitch);
+					SDL_DestroySurface(converted);
 				}
+				res.background.invalidate();
 			}
 			else
 			{
-				obj.texture = tex;
-				obj.currentAnimation = animIndex;
-			}
-		};
-
-		switch (obj.data.player.state)
-		{
-			case PlayerState::idle:
-			{
-				// Switching to running state
-				if (currentDirection)
+				SDL_Texture *newTex = SDL_CreateTextureFromSurface(state.renderer, asset.surface);
+				if (!newTex)
 				{
-					obj.data.player.state = PlayerState::running;
+					SDL_DestroySurface(asset.surface);
+					continue;
 				}
-				else
+				SDL_SetTextureScaleMode(newTex, SDL_SCALEMODE_NEAREST);
+				if (!res.cache.replaceTexture(asset.path, newTex))
 				{
-					// Decelerate
-					if (obj.velocity.x)
+					SDL_DestroyTexture(newTex);
+					SDL_DestroySurface(asset.surface);
+					continue;
+				}
+				res.replaceTexture(oldTex, newTex);
+
+				// Live objects hold texture pointers too
+				auto const swapIn = [oldTex, newTex](std::vector<GameObject> &objects)
+				{
+					for (GameObject &obj : objects)
 					{
-						float const factor = obj.velocity.x > 0 ? -1.5f : 1.5f;
-						float amount = factor * obj.acceleration.x * deltaTime;
-						if (std::abs(obj.velocity.x) < std::abs(amount))
-						{
-							obj.velocity.x = 0;
-						}
-						else
+						if (obj.texture == oldTex)
 						{
-							obj.velocity.x += amount;
+							obj.texture = newTex;
 						}
 					}
-				}
-
-				handleShooting(res.texIdle, res.texShoot, res.ANIM_PLAYER_IDLE, res.ANIM_PLAYER_SHOOT);
-				break;
-			}
-			case PlayerState::running:
-			{
-				// Switching to idle state
-				if (!currentDirection)
+				};
+				for (auto &layer : gs.layers)
 				{
-					obj.data.player.state = PlayerState::idle;
+					swapIn(layer);
 				}
+				swapIn(gs.backgroundTiles);
+				swapIn(gs.foregroundTiles);
+				swapIn(gs.bullets);
 
-				// Moving in opposite dirction of velocity, sliding!
-				if (obj.velocity.x * obj.direction < 0 && obj.grounded)
-				{
-					handleShooting(res.texSlide, res.texSlideShoot, res.ANIM_PLAYER_SLIDE_SHOOT, res.ANIM_PLAYER_SLIDE_SHOOT);
-				}
-				else
-				{
-					handleShooting(res.texRun, res.texRunShoot, res.ANIM_PLAYER_RUN, res.ANIM_PLAYER_RUN);
-				}
-				break;
-			}
-			case PlayerState::jumping:
-			{
-				handleShooting(res.texRun, res.texRunShoot, res.ANIM_PLAYER_RUN, res.ANIM_PLAYER_RUN);
-				break;
+				SDL_DestroyTexture(oldTex);
 			}
+			SDL_DestroySurface(asset.surface);
 		}
-	}
-	else if (obj.type == ObjectType::bullet)
-	{
-		switch (obj.data.bullet.state)
+		else if (asset.audio)
 		{
-			case BulletState::moving:
+			MIX_Audio *oldAudio = res.cache.findAudio(asset.path);
+			if (!oldAudio)
 			{
-				if (obj.position.x - gs.mapViewport.x < 0 || // left edge
-					obj.position.x - gs.mapViewport.x > state.logW || // right edge
-					obj.position.y - gs.mapViewport.y < 0 || // top edge
-					obj.position.y - gs.mapViewport.y > state.logH) // bottom edge
-				{
-					obj.data.bullet.state = BulletState::inactive;
-				}
-				break;
+				MIX_DestroyAudio(asset.audio);
+				continue;
 			}
-			case BulletState::colliding:
+			if (!res.cache.replaceAudio(asset.path, asset.audio))
 			{
-				if (obj.animations[obj.currentAnimation].isDone())
-				{
-					obj.data.bullet.state = BulletState::inactive;
-				}
+				MIX_DestroyAudio(asset.audio);
+				continue;
 			}
-		}
-	}
-	else if (obj.type == ObjectType::enemy)
-	{
-		switch (obj.data.enemy.state)
-		{
-			case EnemyState::shambling:
+			for (MIX_Track *track : res.tracks)
 			{
-				glm::vec2 playerDir = gs.player().position - obj.position;
-				if (glm::length(playerDir) < 100)
-				{
-					currentDirection = playerDir.x < 0 ? -1 : 1;
-					obj.acceleration = glm::vec2(30, 0);
-				}
-				else
+				if (MIX_GetTrackAudio(track) == oldAudio)
 				{
-					obj.acceleration = glm::vec2(0);
-					obj.velocity.x = 0;
+					MIX_SetTrackAudio(track, asset.audio);
 				}
-				break;
 			}
-			case EnemyState::damaged:
+			MIX_DestroyAudio(oldAudio);
+		}
+		else if (asset.map)
+		{
+			if (!asset.map->hasSpawn("player"))
 			{
-				if (obj.data.enemy.damagedTimer.step(deltaTime))
-				{
-					obj.data.enemy.state = EnemyState::shambling;
-					obj.texture = res.texEnemy;
-					obj.currentAnimation = res.ANIM_ENEMY;
-				}
-				break;
+				SDL_Log("Reload: %s leaves the map without a player spawn, keeping the current map", asset.path.c_str());
+				continue;
 			}
-			case EnemyState::dead:
+
+			// The level lists are built anew from the map, the characters stay
+			// where they are and the new map's spawns become the spawn table
+			res.map = std::move(*asset.map);
+			levelChanged = true;
+			res.bindTileTextures(state.renderer);
+			std::vector<GameObject> characters = std::move(gs.layers[LAYER_IDX_CHARACTERS]);
+			int const playerIndex = gs.playerIndex;
+			int const rivalIndex = gs.rivalIndex;
+			gs.layers[LAYER_IDX_LEVEL].clear();
+			gs.layers[LAYER_IDX_CHARACTERS].clear();
+			gs.backgroundTiles.clear();
+			gs.foregroundTiles.clear();
+			gs.playerIndex = -1;
+			gs.rivalIndex = -1;
+			gs.setMap(res.map);
+			createTiles(state, gs, res);
+			if (rivalIndex != -1)
 			{
-				obj.velocity.x = 0;
-				if (obj.currentAnimation != -1 &&
-					obj.animations[obj.currentAnimation].isDone())
-				{
-					// Remove animation and set to last frame
-					obj.currentAnimation = -1;
-					obj.spriteFrame = 18;
-				}
+				addRival(gs);
 			}
+			gs.recordSpawns();
+			gs.layers[LAYER_IDX_CHARACTERS] = std::move(characters);
+			gs.playerIndex = playerIndex;
+			gs.rivalIndex = rivalIndex;
+			gs.rebuildLevel(res.map.tileset);
 		}
-	}
-
-	if (currentDirection)
-	{
-		obj.direction = currentDirection;
-	}
-
-	// Add acceleration to velocity
-	obj.velocity += currentDirection * obj.acceleration * deltaTime;
-	if (std::abs(obj.velocity.x) > obj.maxSpeedX)
-	{
-		obj.velocity.x = currentDirection * obj.maxSpeedX;
-	}
-
-	// Add velocity to position
-	obj.position += obj.velocity * deltaTime;
-
-	// Handle collision detection
-	bool foundGround = false;
-	for (auto &layer : gs.layers)
-	{
-		for (GameObject &objB : layer)
+		else if (asset.sprites)
 		{
-			if (&obj != &objB)
+			// Animations point into the clips of the old sheet, which stays
+			// alive until every one of them is moved over by clip name
+			SpriteSheet const old = std::move(res.sprites);
+			res.sprites = std::move(*asset.sprites);
+			levelChanged = true;
+			res.bindClipTextures(state.renderer);
+			res.createAnimations();
+			auto const rebind = [&res](std::vector<GameObject> &objects)
 			{
-				checkCollisions(state, gs, res, obj, objB, deltaTime);
-
-				if (objB.type == ObjectType::level)
+				for (GameObject &obj : objects)
 				{
-					// Grounded sensor
-					SDL_FRect sensor {
-						.x = obj.position.x + obj.collider.x,
-						.y = obj.position.y + obj.collider.y + obj.collider.h,
-						.w = obj.collider.w,
-						.h = 1,
-					};
-
-					SDL_FRect rectB {
-						.x = objB.position.x + objB.collider.x,
-						.y = objB.position.y + objB.collider.y,
-						.w = objB.collider.w,
-						.h = objB.collider.h,
-					};
-
-					SDL_FRect rectC { 0 };
-
-					if (SDL_GetRectIntersectionFloat(&sensor, &rectB, &rectC))
+					for (Animation &anim : obj.animations)
 					{
-						foundGround = true;
+						SpriteClip const *clip = anim.getClip();
+						if (!clip)
+						{
+							continue;
+						}
+						// Finished clips that hold their last frame stay finished
+						Animation fresh(res.sprites.clip(clip->name));
+						fresh.step(anim.isDone() && !clip->loop ? fresh.getLength() : anim.getTimer().getTime());
+						anim = fresh;
 					}
 				}
+			};
+			for (auto &layer : gs.layers)
+			{
+				rebind(layer);
 			}
+			rebind(gs.bullets);
+			rebind(gs.spawns);
 		}
+
+		uint64_t const end = SDL_GetPerformanceCounter();
+		SDL_Log("Reload: %s applied in %.3f ms", asset.path.c_str(),
+			static_cast<double>(end - begin) * 1000.0 / SDL_GetPerformanceFrequency());
 	}
+	assets.clear();
+	return levelChanged;
+}
 
-	if (obj.grounded != foundGround)
+// Times CSV layer parsing with every parser this machine supports, on the
+// given map and on a 4000x500 map generated by tiling its layers
+int runMapBenchmark(std::string const &mapPath)
+{
+	size_t size = 0;
+	char *text = static_cast<char *>(SDL_LoadFile(mapPath.c_str(), &size));
+	TileMap map;
+	if (!text || !map.parse(std::string_view(text, size), mapPath, "data/tiles"))
 	{
-		// Switching grounded state
-		obj.grounded = foundGround;
-		if (foundGround && obj.type == ObjectType::player)
+		SDL_free(text);
+		return 1;
+	}
+
+	// CSV bodies of every layer as written in the file
+	std::vector<std::string_view> layerText;
+	XmlScanner xml(std::string_view(text, size));
+	while (xml.next())
+	{
+		if (xml.is("data") && xml.attribute("encoding") == "csv")
 		{
-			obj.data.player.state = PlayerState::idle;
+			layerText.push_back(xml.content());
 		}
 	}
-}
-
-void collisionResponse(SDLState const &state, GameState &gs, Resources &res,
-	SDL_FRect &rectA, SDL_FRect &rectB, SDL_FRect &rectC,
-	GameObject &objA, GameObject &objB, float deltaTime)
-{
-	auto const genericResponse = [&]()
+
+	int const GEN_W = 4000, GEN_H = 500;
+	std::vector<std::string> generated;
+	for (TileLayer const &layer : map.layers)
 	{
-		if (rectC.w < rectC.h)
+		std::string csv;
+		csv.reserve(static_cast<size_t>(GEN_W) * GEN_H * 3);
+		for (int r = 0; r < GEN_H; r++)
 		{
-			// Horizontal collision
-			if (objA.velocity.x > 0)
-			{
-				objA.position.x -= rectC.w; // going right
-			}
-			else if (objA.velocity.x < 0)
+			for (int c = 0; c < GEN_W; c++)
 			{
-				objA.position.x += rectC.w; // going left
+				csv += std::to_string(layer.tiles[(r % map.height) * map.width + c % map.width]);
+				csv += ',';
 			}
-			objA.velocity.x = 0;
+			csv += '\n';
 		}
-		else
+		generated.push_back(std::move(csv));
+	}
+
+	auto const timeParser = [](std::vector<std::string_view> const &layers, size_t cells, CsvParser parser, int iterations)
+	{
+		std::vector<Uint32> tiles(cells);
+		uint64_t const begin = SDL_GetPerformanceCounter();
+		for (int i = 0; i < iterations; i++)
 		{
-			// Vertical collision
-			if (objA.velocity.y > 0)
+			for (std::string_view layer : layers)
 			{
-				objA.position.y -= rectC.h; // going down
-			}
-			else if (objA.velocity.y < 0)
-			{
-				objA.position.y += rectC.h; // going up
+				if (CsvTileParser::parse(layer.data(), layer.size(), tiles.data(), tiles.size(), parser) != cells)
+				{
+					SDL_Log("bench: %s parser came up short", CsvTileParser::name(parser));
+				}
 			}
-			objA.velocity.y = 0;
 		}
+		return static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency() / iterations;
 	};
 
-	// Object we are checking
-	if (objA.type == ObjectType::player)
+	struct Case
 	{
-		// Object it is colliding with
-		switch (objB.type)
+		char const *name;
+		std::vector<std::string_view> layers;
+		size_t cells;
+		int iterations;
+	};
+	Case cases[] = {
+		{ "file", layerText, static_cast<size_t>(map.width) * map.height, 500 },
+		{ "generated", std::vector<std::string_view>(generated.begin(), generated.end()), static_cast<size_t>(GEN_W) * GEN_H, 10 },
+	};
+	for (Case const &test : cases)
+	{
+		double const scalarMs = timeParser(test.layers, test.cells, CsvParser::scalar, test.iterations);
+		for (CsvParser parser : { CsvParser::scalar, CsvParser::sse2, CsvParser::avx2 })
 		{
-			case ObjectType::level:
+			if (!CsvTileParser::isAvailable(parser))
 			{
-				genericResponse();
-				break;
-			}
-			case ObjectType::enemy:
-			{
-				if (objB.data.enemy.state != EnemyState::dead)
-				{
-					objA.velocity = glm::vec2(100, 0) * -objA.direction;
-				}
-				break;
+				continue;
 			}
+			double const ms = parser == CsvParser::scalar ? scalarMs : timeParser(test.layers, test.cells, parser, test.iterations);
+			SDL_Log("bench.csv.%s.%s_ms=%.3f (%.1fx)", test.name, CsvTileParser::name(parser), ms, scalarMs / ms);
 		}
 	}
-	else if (objA.type == ObjectType::bullet)
+
+	// Whole map load with the parser picked at runtime
+	int const LOADS = 50;
+	uint64_t const begin = SDL_GetPerformanceCounter();
+	for (int i = 0; i < LOADS; i++)
 	{
-		bool passthrough = false;
-		switch (objA.data.bullet.state)
+		TileMap loaded;
+		loaded.parse(std::string_view(text, size), mapPath, "data/tiles");
+	}
+	SDL_Log("bench.map_load_ms=%.3f (%s)", static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1000.0 /
+		SDL_GetPerformanceFrequency() / LOADS, CsvTileParser::name(CsvTileParser::best()));
+
+	SDL_free(text);
+	return 0;
+}
+
+// Sum over what a restore or a restart has to bring back
+double stateFingerprint(GameState const &gs)
+{
+	double sum = gs.playerIndex + gs.camera.view().x;
+	for (std::vector<GameObject> const *list : GameState::objectLists(gs))
+	{
+		for (GameObject const &obj : *list)
 		{
-			case BulletState::moving:
+			sum += obj.position.x + obj.position.y * 3 + obj.currentAnimation * 5 + reinterpret_cast<uintptr_t>(obj.texture) % 7;
+			if (obj.type == ObjectType::level)
 			{
-				switch (objB.type)
-				{
-					case ObjectType::level:
-					{
-						MIX_PlayTrack(res.trackShootHit, 0);
-						break;
-					}
-					case ObjectType::enemy:
-					{
-						EnemyData &d = objB.data.enemy;
-						if (d.state != EnemyState::dead)
-						{
-							objB.direction = -objA.direction;
-							objB.shouldFlash = true;
-							objB.flashTimer.reset();
-							objB.texture = res.texEnemyHit;
-							objB.currentAnimation = res.ANIM_ENEMY_HIT;
-							d.state = EnemyState::damaged;
-							// Damage the enemy and flag dead if needed
-							d.healthPoints -= 10;
-							if (d.healthPoints <= 0)
-							{
-								d.state = EnemyState::dead;
-								objB.texture = res.texEnemyDie;
-								objB.currentAnimation = res.ANIM_ENEMY_DIE;
-							}
-							MIX_PlayTrack(res.trackEnemyHit, 0);
-						}
-						else
-						{
-							// Don't collide with dead enemies
-							passthrough = true;
-						}
-						break;
-					}
-				}
-				if (!passthrough)
-				{
-					genericResponse();
-					objA.velocity *= 0;
-					objA.data.bullet.state = BulletState::colliding;
-					objA.texture = res.texBulletHit;
-					objA.currentAnimation = res.ANIM_BULLET_HIT;
-				}
-				break;
+				sum += obj.data.level.destroyed * 11 + obj.data.level.healthPoints;
+			}
+			else if (obj.type == ObjectType::bullet)
+			{
+				sum += static_cast<int>(obj.data.bullet.state) * 13;
+			}
+			for (Animation const &anim : obj.animations)
+			{
+				sum += anim.currentFrame() + anim.getTimer().getTime();
 			}
 		}
 	}
-	else if (objA.type == ObjectType::enemy)
-	{
-		genericResponse();
-	}
+	return sum;
 }
 
-void checkCollisions(SDLState const &state, GameState &gs, Resources &res,
-	GameObject &a, GameObject &b, float deltaTime)
+// Times saving and restoring the whole simulation with more and more enemies
+// added to the map. Textures are blank placeholders on a software renderer.
+int runSnapshotBenchmark(std::string const &mapPath)
 {
-	SDL_FRect rectA {
-		.x = a.position.x + a.collider.x,
-		.y = a.position.y + a.collider.y,
-		.w = a.collider.w,
-		.h = a.collider.h,
-	};
+	SDLState state;
+	state.logW = 640;
+	state.logH = 320;
+	Resources res;
+	if (!res.map.load(mapPath, "data/tiles") || !res.sprites.load("data/sprites.xml"))
+	{
+		return 1;
+	}
+	SDL_Surface *surface = SDL_CreateSurface(TILE_SIZE, TILE_SIZE, SDL_PIXELFORMAT_RGBA8888);
+	SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+	if (!renderer)
+	{
+		SDL_Log("bench: no software renderer: %s", SDL_GetError());
+		SDL_DestroySurface(surface);
+		return 1;
+	}
+	res.createAnimations();
+	res.createPlaceholders(renderer);
 
-	SDL_FRect rectB {
-		.x = b.position.x + b.collider.x,
-		.y = b.position.y + b.collider.y,
-		.w = b.collider.w,
-		.h = b.collider.h,
-	};
+	GameState gs(state, res.map);
+	createTiles(state, gs, res);
+	GameObject enemy = gs.player();
+	enemy.type = ObjectType::enemy;
+	enemy.data.enemy = EnemyData();
+	enemy.animations = res.enemyAnims;
+	enemy.currentAnimation = res.ANIM_ENEMY;
 
-	SDL_FRect rectC { 0 };
+	auto const msSince = [](uint64_t begin, int iterations)
+	{
+		return static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency() / iterations;
+	};
 
-	if (SDL_GetRectIntersectionFloat(&rectA, &rectB, &rectC))
+	int const ITERATIONS = 20;
+	int result = 0;
+	Snapshot snap, copy;
+	for (int enemies : { 0, 10000, 100000 })
 	{
-		// Found intersection, respond accordingly
-		collisionResponse(state, gs, res, rectA, rectB, rectC, a, b, deltaTime);
+		std::vector<GameObject> &characters = gs.layers[LAYER_IDX_CHARACTERS];
+		for (int i = 0; i < enemies; i++)
+		{
+			enemy.position = glm::vec2(SDL_randf() * gs.mapBounds.w, SDL_randf() * gs.mapBounds.h);
+			enemy.animations[enemy.currentAnimation].step(SDL_randf());
+			characters.push_back(enemy);
+		}
+		size_t objects = 0;
+		for (std::vector<GameObject> const *list : GameState::objectLists(gs))
+		{
+			objects += list->size();
+		}
+
+		SnapshotIds const ids(res.textures, res.sprites);
+		gs.save(snap, ids); // grows the blob once
+		uint64_t begin = SDL_GetPerformanceCounter();
+		for (int i = 0; i < ITERATIONS; i++)
+		{
+			gs.save(snap, ids);
+		}
+		double const saveMs = msSince(begin, ITERATIONS);
+
+		begin = SDL_GetPerformanceCounter();
+		for (int i = 0; i < ITERATIONS; i++)
+		{
+			copy.assign(snap.getData(), snap.getSize());
+		}
+		double const copyMs = msSince(begin, ITERATIONS);
+
+		// Disturb the state so restoring has something to undo
+		double const expected = stateFingerprint(gs);
+		for (GameObject &obj : characters)
+		{
+			obj.position += glm::vec2(7, 3);
+			if (obj.currentAnimation != -1)
+			{
+				obj.animations[obj.currentAnimation].step(0.3f);
+			}
+		}
+		gs.bullets.clear();
+		begin = SDL_GetPerformanceCounter();
+		for (int i = 0; i < ITERATIONS; i++)
+		{
+			gs.restore(copy, ids);
+		}
+		double const restoreMs = msSince(begin, ITERATIONS);
+		if (stateFingerprint(gs) != expected)
+		{
+			SDL_Log("bench: restored state differs from the saved one");
+			result = 1;
+		}
+
+		SDL_Log("bench.snapshot.%zu_objects.bytes=%zu", objects, snap.getSize());
+		SDL_Log("bench.snapshot.%zu_objects.save_ms=%.3f", objects, saveMs);
+		SDL_Log("bench.snapshot.%zu_objects.restore_ms=%.3f", objects, restoreMs);
+		SDL_Log("bench.snapshot.%zu_objects.memcpy_ms=%.3f", objects, copyMs);
 	}
+
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroySurface(surface);
+	return result;
 }
 
-void createTiles(SDLState const &state, GameState &gs, Resources &res)
+// Times particle integration, scalar and SIMD, and drawing with 50k and more
+// particles alive. Drawing goes to a software renderer, so it includes rasterization.
+int runParticleBenchmark()
 {
-	/*
-		1 - Ground
-		2 - Panel
-		3 - Enemy
-		4 - Player
-		5 - Grass
-		6 - Brick
-	*/
-	short map[MAP_ROWS][MAP_COLS] = {
-		4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 3, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 3, 3, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 2, 0, 0, 2, 2, 2, 2, 0, 2, 2, 2, 0, 0, 3, 2, 2, 2, 2, 0, 0, 2, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 2, 0, 2, 2, 0, 0, 0, 3, 0, 0, 3, 0, 2, 2, 2, 2, 2, 0, 0, 2, 2, 0, 3, 0, 0, 3, 0, 2, 3, 3, 3, 0, 2, 0, 3, 3, 0, 0, 3, 0, 3, 0, 3,
-		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-	};
-
-	short background[MAP_ROWS][MAP_COLS] = {
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 6, 6, 6, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 0, 6, 6, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 0, 0, 6, 6, 6, 6, 6, 6, 6, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 6, 6, 6, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	};
+	int const W = 640, H = 320;
+	SDL_Surface *surface = SDL_CreateSurface(W, H, SDL_PIXELFORMAT_RGBA8888);
+	SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+	if (!renderer)
+	{
+		SDL_Log("bench: no software renderer: %s", SDL_GetError());
+		SDL_DestroySurface(surface);
+		return 1;
+	}
+	RenderContext gfx;
+	gfx.setRenderer(renderer);
+	SDL_FRect const view { 0, 0, static_cast<float>(W), static_cast<float>(H) };
 
-	short foreground[MAP_ROWS][MAP_COLS] = {
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		5, 5, 5, 5, 5, 5, 5, 0, 0, 0, 0, 0, 0, 0, 0, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	auto const msSince = [](uint64_t begin, int iterations)
+	{
+		return static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency() / iterations;
 	};
 
-	auto const loadMap = [&state, &gs, &res](short layer[MAP_ROWS][MAP_COLS])
+	int const TICKS = 200;
+	ParticleBurst burst = BURST_ENEMY_DEATH;
+	burst.minLife = burst.maxLife = 60.0f; // nothing dies while timing
+	for (int count : { 50000, ParticleSystem::CAPACITY })
 	{
-		auto const createObject = [&state](int r, int c, SDL_Texture *tex, ObjectType type)
+		auto particles = std::make_unique<ParticleSystem>();
+		for (int i = 0; i < count; i += 100)
 		{
-			GameObject o;
-			o.type = type;
-			o.position = glm::vec2(c * TILE_SIZE, state.logH - (MAP_ROWS - r) * TILE_SIZE);
-			o.texture = tex;
-			o.collider = { .x = 0, .y = 0, .w = TILE_SIZE, .h = TILE_SIZE };
-			return o;
-		};
+			particles->emit(burst, glm::vec2(SDL_randf() * W, SDL_randf() * H), std::min(100, count - i));
+		}
 
-		for (int r = 0; r < MAP_ROWS; r++)
+		for (bool simd : { false, true })
 		{
-			for (int c = 0; c < MAP_COLS; c++)
+			uint64_t const begin = SDL_GetPerformanceCounter();
+			for (int i = 0; i < TICKS; i++)
 			{
-				switch (layer[r][c])
-				{
-					case 1: // ground
-					{
-						GameObject ground = createObject(r, c, res.texGround, ObjectType::level);
-						gs.layers[LAYER_IDX_LEVEL].push_back(ground);
-						break;
-					}
-					case 2: // ground
-					{
-						GameObject panel = createObject(r, c, res.texPanel, ObjectType::level);
-						gs.layers[LAYER_IDX_LEVEL].push_back(panel);
-						break;
-					}
-					case 3: // enemy
-					{
-						GameObject o = createObject(r, c, res.texEnemy, ObjectType::enemy);
-						o.data.enemy = EnemyData();
-						o.currentAnimation = res.ANIM_ENEMY;
-						o.animations = res.enemyAnims;
-						o.collider = SDL_FRect { .x = 10, .y = 4, .w = 12, .h = 28 };
-						o.maxSpeedX = 15;
-						o.dynamic = true;
-						gs.layers[LAYER_IDX_CHARACTERS].push_back(o);
-						break;
-					}
-					case 4: // player
-					{
-						GameObject player = createObject(r, c, res.texIdle, ObjectType::player);
-						player.data.player = PlayerData();
-						player.animations = res.playerAnims;
-						player.currentAnimation = res.ANIM_PLAYER_IDLE;
-						player.acceleration = glm::vec2(300, 0);
-						player.maxSpeedX = 100;
-						player.dynamic = true;
-						player.collider = { .x = 11, .y = 6, .w = 10, .h = 26 };
-						gs.layers[LAYER_IDX_CHARACTERS].push_back(player);
-						gs.playerIndex = gs.layers[LAYER_IDX_CHARACTERS].size() - 1;
-						break;
-					}
-					case 5: // Grass
-					{
-						GameObject o = createObject(r, c, res.texGrass, ObjectType::level);
-						gs.foregroundTiles.push_back(o);
-						break;
-					}
-					case 6: // Brick
-					{
-						GameObject o = createObject(r, c, res.texBrick, ObjectType::level);
-						gs.backgroundTiles.push_back(o);
-						break;
-					}
-				}
+				particles->update(NET_TICK, GRAVITY, simd);
 			}
+			SDL_Log("bench.particles.%d.update_%s_ms=%.3f", count, simd ? "simd" : "scalar", msSince(begin, TICKS));
 		}
-	};
 
-	loadMap(map);
-	loadMap(background);
-	loadMap(foreground);
+		int const DRAWS = 20;
+		uint64_t const begin = SDL_GetPerformanceCounter();
+		for (int i = 0; i < DRAWS; i++)
+		{
+			particles->draw(gfx, view, PARTICLE_SIZE);
+		}
+		SDL_FlushRenderer(renderer);
+		SDL_Log("bench.particles.%d.draw_ms=%.3f (%d visible)", count, msSince(begin, DRAWS), particles->getDrawn());
+	}
 
-	assert(gs.playerIndex != -1);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroySurface(surface);
+	return 0;
 }
 
-void handleKeyInput(SDLState const &state, GameState &gs, GameObject &obj, SDL_Scancode key, bool keyDown)
+// Times restarting the level in place against building it again with
+// createTiles(), after a bit of play: characters moved and animated, enemies
+// killed, breakable tiles destroyed and bullets in flight. Restarts must
+// bring back the starting state without reallocating any list.
+int runRestartBenchmark(std::string const &mapPath)
 {
-	float const JUMP_FORCE = -200.0f;
+	SDLState state;
+	state.logW = 640;
+	state.logH = 320;
+	Resources res;
+	if (!res.map.load(mapPath, "data/tiles") || !res.sprites.load("data/sprites.xml"))
+	{
+		return 1;
+	}
+	SDL_Surface *surface = SDL_CreateSurface(TILE_SIZE, TILE_SIZE, SDL_PIXELFORMAT_RGBA8888);
+	SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+	if (!renderer)
+	{
+		SDL_Log("bench: no software renderer: %s", SDL_GetError());
+		SDL_DestroySurface(surface);
+		return 1;
+	}
+	res.createAnimations();
+	res.createPlaceholders(renderer);
 
-	if (obj.type == ObjectType::player)
+	auto const msSince = [](uint64_t begin, int iterations)
 	{
-		switch (obj.data.player.state)
+		return static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency() / iterations;
+	};
+
+	int const ITERATIONS = 20;
+	uint64_t begin = SDL_GetPerformanceCounter();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		GameState fresh(state, res.map);
+		createTiles(state, fresh, res);
+		fresh.rebuildLevel(res.map.tileset);
+	}
+	double const createMs = msSince(begin, ITERATIONS);
+
+	GameState gs(state, res.map);
+	createTiles(state, gs, res);
+	gs.rebuildLevel(res.map.tileset);
+	gs.camera.snapTo(gs.focus());
+	gs.updateActiveChunks();
+	gs.recordSpawns();
+	GameObject bullet;
+	bullet.type = ObjectType::bullet;
+	bullet.data.bullet = BulletData();
+	bullet.data.bullet.state = BulletState::inactive;
+	gs.bullets.assign(MAX_BULLETS_CAPPED, bullet);
+	double const expected = stateFingerprint(gs);
+
+	// Every list and animation list restarts must keep
+	auto const storage = [&gs]()
+	{
+		std::vector<void const *> pointers;
+		for (std::vector<GameObject> const *list : GameState::objectLists(gs))
 		{
-			case PlayerState::idle:
+			pointers.push_back(list->data());
+			for (GameObject const &obj : *list)
 			{
-				if (key == SDL_SCANCODE_K && keyDown)
-				{
-					obj.data.player.state = PlayerState::jumping;
-					obj.velocity.y += JUMP_FORCE;
-				}
-				break;
+				pointers.push_back(obj.animations.data());
 			}
-			case PlayerState::running:
+		}
+		return pointers;
+	};
+	std::vector<void const *> const expectedStorage = storage();
+
+	auto const play = [&gs, &res]()
+	{
+		for (GameObject &obj : gs.layers[LAYER_IDX_CHARACTERS])
+		{
+			obj.position += glm::vec2(SDL_randf() * 40, SDL_randf() * 40);
+			if (obj.type == ObjectType::enemy && SDL_rand(2))
 			{
-				if (key == SDL_SCANCODE_K && keyDown)
-				{
-					obj.data.player.state = PlayerState::jumping;
-					obj.velocity.y += JUMP_FORCE;
-				}
-				break;
+				obj.data.enemy.state = EnemyState::dead;
+			}
+			if (obj.currentAnimation != -1)
+			{
+				obj.animations[obj.currentAnimation].step(SDL_randf());
 			}
 		}
+		for (int i = 0; i < gs.layers[LAYER_IDX_LEVEL].size(); i++)
+		{
+			gs.damageTile(i, TILE_HEALTH);
+		}
+		gs.commitTileChanges(res.map.tileset);
+		for (GameObject &bullet : gs.bullets)
+		{
+			bullet.data.bullet.state = BulletState::moving;
+		}
+		gs.particles.emit(BURST_ENEMY_DEATH, gs.player().position, 500);
+		gs.camera.snapTo(glm::vec2(gs.mapBounds.w, gs.mapBounds.h));
+	};
+
+	int result = 0;
+	double restartMs = 0;
+	int const RESTARTS = 1000;
+	for (int i = 0; i < RESTARTS; i++)
+	{
+		play();
+		begin = SDL_GetPerformanceCounter();
+		gs.restart(res.map.tileset);
+		restartMs += msSince(begin, 1);
+		if (stateFingerprint(gs) != expected || storage() != expectedStorage)
+		{
+			SDL_Log("bench: restart %d did not bring back the starting state in place", i);
+			result = 1;
+			break;
+		}
+	}
+	restartMs /= RESTARTS;
+
+	size_t objects = 0;
+	for (std::vector<GameObject> const *list : GameState::objectLists(gs))
+	{
+		objects += list->size();
 	}
+	SDL_Log("bench.restart.%zu_objects.create_ms=%.3f", objects, createMs);
+	SDL_Log("bench.restart.%zu_objects.restart_ms=%.4f (%.0fx)", objects, restartMs, createMs / restartMs);
+
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroySurface(surface);
+	return result;
 }
 
-void drawParalaxBackground(SDL_Renderer *renderer, SDL_Texture *texture,
-	float xVelocity, float &scrollPos, float scrollFactor, float deltaTime)
+// Times the scene drawing of drawScene() on a software renderer over a
+// surface, so it runs on hosts without a GPU or a display. The camera pans
+// across the map with the parallax layers scrolling, bullets in flight and
+// particles alive. Frames are timed whole, then pass by pass with a renderer
+// flush after each pass.
+int runRenderBenchmark(std::string const &mapPath)
 {
-	scrollPos -= xVelocity * scrollFactor * deltaTime;
-	if (scrollPos <= -texture->w)
+	SDLState state;
+	state.logW = 640;
+	state.logH = 320;
+	Resources res;
+	if (!res.map.load(mapPath, "data/tiles") || !res.sprites.load("data/sprites.xml"))
+	{
+		return 1;
+	}
+	SDL_Surface *surface = SDL_CreateSurface(state.logW, state.logH, SDL_PIXELFORMAT_RGBA8888);
+	state.renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+	if (!state.renderer)
+	{
+		SDL_Log("bench: no software renderer: %s", SDL_GetError());
+		SDL_DestroySurface(surface);
+		return 1;
+	}
+	state.gfx.setRenderer(state.renderer);
+	state.batch.setContext(&state.gfx);
 	{
-		scrollPos = 0;
+		TaskGroup tasks(state.startup);
+		res.decodeImages(tasks);
+		res.createAnimations();
+		res.uploadImages(state, tasks);
 	}
 
-	SDL_FRect dst {
-		.x = scrollPos,
-		.y = 10,
-		.w = static_cast<float>(texture->w * 2),
-		.h = static_cast<float>(texture->h),
+	GameState gs(state, res.map);
+	createTiles(state, gs, res);
+	GameObject bullet;
+	bullet.type = ObjectType::bullet;
+	bullet.data.bullet = BulletData();
+	bullet.animations = res.bulletAnims;
+	bullet.currentAnimation = res.ANIM_BULLET_MOVING;
+	SDL_FRect const &frame = res.bulletAnims[res.ANIM_BULLET_MOVING].frame(false).dst;
+	bullet.collider = SDL_FRect { 0, 0, frame.w, frame.h };
+	gs.bullets.assign(MAX_BULLETS_CAPPED, bullet);
+
+	// Frame f shows the same scene in both runs
+	int const FRAMES = 300;
+	float const panWidth = std::max(0.0f, gs.mapBounds.w - state.logW);
+	float const focusY = gs.focus().y;
+	auto const setupFrame = [&](int f)
+	{
+		float const x = panWidth * f / (FRAMES - 1);
+		gs.camera.snapTo(glm::vec2(x + state.logW / 2.0f, focusY));
+		SDL_FRect const view = gs.camera.view();
+		for (int i = 0; i < gs.bullets.size(); i++)
+		{
+			gs.bullets[i].position = glm::vec2(view.x + (i * 37 + f * 5) % state.logW, view.y + (i * 53) % state.logH);
+		}
+		updateParalaxBackground(res.background.getLayerWidth(res.bgLayer4), 100, gs.bg4Scroll, 0.075f, NET_TICK);
+		updateParalaxBackground(res.background.getLayerWidth(res.bgLayer3), 100, gs.bg3Scroll, 0.15f, NET_TICK);
+		updateParalaxBackground(res.background.getLayerWidth(res.bgLayer2), 100, gs.bg2Scroll, 0.3f, NET_TICK);
+		if (f % 10 == 0)
+		{
+			gs.particles.emit(BURST_ENEMY_DEATH, glm::vec2(view.x + view.w / 2, view.y + view.h / 2), 160);
+		}
+		gs.particles.update(NET_TICK, GRAVITY);
 	};
+	auto const msSince = [](uint64_t begin, int iterations)
+	{
+		return static_cast<double>(SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency() / iterations;
+	};
+
+	// Whole frames as the game draws them
+	Uint64 drawCalls = 0;
+	gs.particles.clear();
+	uint64_t const begin = SDL_GetPerformanceCounter();
+	for (int f = 0; f < FRAMES; f++)
+	{
+		setupFrame(f);
+		state.gfx.beginFrame();
+		state.gfx.setTarget(nullptr);
+		drawScene(state, gs, res);
+		SDL_FlushRenderer(state.renderer);
+		drawCalls += state.gfx.frameStats().drawCalls;
+	}
+	SDL_Log("bench.render.frame_ms=%.3f draw_calls=%.1f", msSince(begin, FRAMES), static_cast<double>(drawCalls) / FRAMES);
+
+	// The same frames pass by pass
+	ScenePassStats profile;
+	gs.particles.clear();
+	gs.bg2Scroll = gs.bg3Scroll = gs.bg4Scroll = 0;
+	for (int f = 0; f < FRAMES; f++)
+	{
+		setupFrame(f);
+		state.gfx.beginFrame();
+		state.gfx.setTarget(nullptr);
+		drawScene(state, gs, res, &profile);
+	}
+	for (int pass = 0; pass < static_cast<int>(ScenePass::count); pass++)
+	{
+		SDL_Log("bench.render.%s_ms=%.3f draw_calls=%.1f", SCENE_PASS_NAMES[pass],
+			profile.ms[pass] / FRAMES, static_cast<double>(profile.drawCalls[pass]) / FRAMES);
+	}
 
-	SDL_RenderTextureTiled(renderer, texture, nullptr, 1, &dst);
+	res.background.destroy();
+	res.cache.clear();
+	SDL_DestroyRenderer(state.renderer);
+	SDL_DestroySurface(surface);
+	return 0;
 }
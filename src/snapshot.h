@@ -0,0 +1,191 @@
+#pragma once
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+#include "gameobject.h"
+#include "spritesheet.h"
+
+// Flat byte image of the simulation. Only trivially copyable, pointer free
+// records go in, so a blob can be copied, kept or sent around as it is.
+// Clearing keeps the memory, saving into the same snapshot again does not
+// allocate once it has grown to the size of the state.
+class Snapshot
+{
+	std::vector<Uint8> bytes;
+	size_t used;
+
+	static size_t alignUp(size_t offset, size_t alignment)
+	{
+		return (offset + alignment - 1) & ~(alignment - 1);
+	}
+
+public:
+	Snapshot() : used(0)
+	{
+	}
+
+	Uint8 const *getData() const { return bytes.data(); }
+	size_t getSize() const { return used; }
+
+	void clear() { used = 0; }
+
+	void assign(void const *data, size_t size)
+	{
+		reserve(size);
+		SDL_memcpy(bytes.data(), data, size);
+		used = size;
+	}
+
+	// Makes appends up to size bytes keep earlier pointers valid
+	void reserve(size_t size)
+	{
+		if (bytes.size() < size)
+		{
+			bytes.resize(size);
+		}
+	}
+
+	// Room for count records at the end, valid until the blob grows past what was reserved
+	template <typename T>
+	T *append(size_t count)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		size_t const offset = alignUp(used, alignof(T));
+		used = offset + sizeof(T) * count;
+		if (bytes.size() < used)
+		{
+			bytes.resize(used * 2);
+		}
+		return reinterpret_cast<T *>(bytes.data() + offset);
+	}
+
+	// Records at offset, which is advanced past them. Null when the blob is too short.
+	template <typename T>
+	T const *read(size_t &offset, size_t count) const
+	{
+		size_t const start = alignUp(offset, alignof(T));
+		if (start + sizeof(T) * count > used)
+		{
+			return nullptr;
+		}
+		offset = start + sizeof(T) * count;
+		return reinterpret_cast<T const *>(bytes.data() + start);
+	}
+};
+
+// Stable ids for what objects point at: textures by their position in the
+// resource texture list, clips by their position in the sprite sheet. Build
+// one per save or restore, hot reloads swap the pointers behind the ids.
+class SnapshotIds
+{
+	std::vector<SDL_Texture *> const &textures;
+	std::unordered_map<SDL_Texture const *, Uint16> textureIds;
+	SpriteSheet const &sprites;
+
+public:
+	static Uint16 const NO_TEXTURE = 0xffff;
+
+	SnapshotIds(std::vector<SDL_Texture *> const &textures, SpriteSheet const &sprites) : textures(textures), sprites(sprites)
+	{
+		for (size_t i = 0; i < textures.size() && i < NO_TEXTURE; i++)
+		{
+			textureIds.emplace(textures[i], static_cast<Uint16>(i));
+		}
+	}
+
+	Uint16 textureId(SDL_Texture const *tex) const
+	{
+		auto it = tex ? textureIds.find(tex) : textureIds.end();
+		return it != textureIds.end() ? it->second : NO_TEXTURE;
+	}
+
+	SDL_Texture *texture(Uint16 id) const
+	{
+		return id < textures.size() ? textures[id] : nullptr;
+	}
+
+	Sint16 clipId(SpriteClip const *clip) const { return static_cast<Sint16>(sprites.indexOf(clip)); }
+	SpriteClip const &clip(Sint16 id) const { return sprites.clipAt(id); }
+};
+
+struct AnimationRecord
+{
+	Timer timer;
+	Sint32 frameIndex;
+	Sint16 clip;
+};
+
+// Everything a GameObject holds, its animations follow in a separate array
+struct ObjectRecord
+{
+	ObjectType type;
+	ObjectData data;
+	glm::vec2 position, velocity, acceleration;
+	float direction;
+	float maxSpeedX;
+	float animDebt;
+	SDL_FRect collider;
+	Timer flashTimer;
+	Sint16 currentAnimation;
+	Uint16 texture;
+	Uint8 animationCount;
+	bool dynamic;
+	bool grounded;
+	bool shouldFlash;
+
+	// Fills the record and the object's animationCount animation records
+	void save(GameObject const &obj, SnapshotIds const &ids, AnimationRecord *anims)
+	{
+		type = obj.type;
+		data = obj.data;
+		position = obj.position;
+		velocity = obj.velocity;
+		acceleration = obj.acceleration;
+		direction = obj.direction;
+		maxSpeedX = obj.maxSpeedX;
+		animDebt = obj.animDebt;
+		collider = obj.collider;
+		flashTimer = obj.flashTimer;
+		currentAnimation = static_cast<Sint16>(obj.currentAnimation);
+		texture = ids.textureId(obj.texture);
+		animationCount = static_cast<Uint8>(obj.animations.size());
+		dynamic = obj.dynamic;
+		grounded = obj.grounded;
+		shouldFlash = obj.shouldFlash;
+		for (size_t i = 0; i < obj.animations.size(); i++)
+		{
+			Animation const &anim = obj.animations[i];
+			anims[i] = AnimationRecord { anim.getTimer(), anim.currentFrame(), ids.clipId(anim.getClip()) };
+		}
+	}
+
+	// Overwrites the object, its animation list keeps its memory when the size matches
+	void restore(GameObject &obj, SnapshotIds const &ids, AnimationRecord const *anims) const
+	{
+		obj.type = type;
+		obj.data = data;
+		obj.position = position;
+		obj.velocity = velocity;
+		obj.acceleration = acceleration;
+		obj.direction = direction;
+		obj.maxSpeedX = maxSpeedX;
+		obj.animDebt = animDebt;
+		obj.collider = collider;
+		obj.flashTimer = flashTimer;
+		obj.currentAnimation = currentAnimation;
+		obj.texture = ids.texture(texture);
+		obj.dynamic = dynamic;
+		obj.grounded = grounded;
+		obj.shouldFlash = shouldFlash;
+		obj.animations.resize(animationCount);
+		for (int i = 0; i < animationCount; i++)
+		{
+			AnimationRecord const &anim = anims[i];
+			obj.animations[i] = Animation(ids.clip(anim.clip), anim.timer, anim.frameIndex);
+		}
+	}
+};
+
+static_assert(std::is_trivially_copyable_v<ObjectRecord>);
+static_assert(std::is_trivially_copyable_v<AnimationRecord>);
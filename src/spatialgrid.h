@@ -0,0 +1,200 @@
+#pragma once
+#include <algorithm>
+#include <span>
+#include <vector>
+#include <SDL3/SDL.h>
+
+struct ObjectRef
+{
+	int layer;
+	int index;
+
+	bool operator<(ObjectRef const &other) const
+	{
+		return layer != other.layer ? layer < other.layer : index < other.index;
+	}
+	bool operator==(ObjectRef const &other) const
+	{
+		return layer == other.layer && index == other.index;
+	}
+};
+
+// Uniform grid broadphase. Objects are binned by their collider bounds with a
+// counting sort, giving a flat cell -> objects table that is rebuilt per tick.
+// Between builds single objects can be removed, and put back into the room
+// their cells had at the last build.
+class SpatialGrid
+{
+	float originX, originY, cellSize;
+	int cols, rows;
+	std::vector<int> cellStart; // cols * rows + 1 offsets into items
+	std::vector<int> cellFill;  // end of the items of each cell, at most the next cell's start
+	std::vector<ObjectRef> items;
+	std::vector<ObjectRef> pending;
+	std::vector<SDL_Rect> pendingCells;
+
+public:
+	SpatialGrid() : originX(0), originY(0), cellSize(1), cols(0), rows(0)
+	{
+	}
+
+	void resize(float x, float y, float width, float height, float size)
+	{
+		originX = x;
+		originY = y;
+		cellSize = size;
+		cols = std::max(1, static_cast<int>(SDL_ceilf(width / size)));
+		rows = std::max(1, static_cast<int>(SDL_ceilf(height / size)));
+		cellStart.assign(cols * rows + 1, 0);
+		cellFill.assign(cols * rows, 0);
+	}
+
+	int getCols() const { return cols; }
+	int getRows() const { return rows; }
+	float getCellSize() const { return cellSize; }
+
+	SDL_FRect cellRect(int col, int row) const
+	{
+		return SDL_FRect {
+			.x = originX + col * cellSize,
+			.y = originY + row * cellSize,
+			.w = cellSize,
+			.h = cellSize,
+		};
+	}
+
+	int cellCount(int col, int row) const
+	{
+		int const cell = row * cols + col;
+		return cellFill[cell] - cellStart[cell];
+	}
+
+	std::span<ObjectRef const> cellItems(int col, int row) const
+	{
+		int const cell = row * cols + col;
+		return std::span<ObjectRef const>(items.data() + cellStart[cell], items.data() + cellFill[cell]);
+	}
+
+	// Cell range covered by a rectangle, clamped to the grid
+	SDL_Rect cellRange(SDL_FRect const &rect) const
+	{
+		int const c0 = std::clamp(static_cast<int>(SDL_floorf((rect.x - originX) / cellSize)), 0, cols - 1);
+		int const r0 = std::clamp(static_cast<int>(SDL_floorf((rect.y - originY) / cellSize)), 0, rows - 1);
+		int const c1 = std::clamp(static_cast<int>(SDL_floorf((rect.x + rect.w - originX) / cellSize)), 0, cols - 1);
+		int const r1 = std::clamp(static_cast<int>(SDL_floorf((rect.y + rect.h - originY) / cellSize)), 0, rows - 1);
+		return SDL_Rect { c0, r0, c1 - c0 + 1, r1 - r0 + 1 };
+	}
+
+	void clear()
+	{
+		pending.clear();
+		pendingCells.clear();
+	}
+
+	void insert(ObjectRef ref, SDL_FRect const &bounds)
+	{
+		pending.push_back(ref);
+		pendingCells.push_back(cellRange(bounds));
+	}
+
+	// Bin everything inserted since clear() into the cell table
+	void build()
+	{
+		std::fill(cellStart.begin(), cellStart.end(), 0);
+		for (SDL_Rect const &range : pendingCells)
+		{
+			for (int r = range.y; r < range.y + range.h; r++)
+			{
+				for (int c = range.x; c < range.x + range.w; c++)
+				{
+					cellStart[r * cols + c + 1]++;
+				}
+			}
+		}
+		for (int i = 0; i < cols * rows; i++)
+		{
+			cellStart[i + 1] += cellStart[i];
+		}
+
+		items.resize(cellStart.back());
+		std::copy(cellStart.begin(), cellStart.end() - 1, cellFill.begin());
+		for (size_t i = 0; i < pending.size(); i++)
+		{
+			SDL_Rect const &range = pendingCells[i];
+			for (int r = range.y; r < range.y + range.h; r++)
+			{
+				for (int c = range.x; c < range.x + range.w; c++)
+				{
+					items[cellFill[r * cols + c]++] = pending[i];
+				}
+			}
+		}
+	}
+
+	// Takes an object out of the cells its bounds cover, the order within a
+	// cell is not kept
+	void remove(ObjectRef ref, SDL_FRect const &bounds)
+	{
+		SDL_Rect const range = cellRange(bounds);
+		for (int r = range.y; r < range.y + range.h; r++)
+		{
+			for (int c = range.x; c < range.x + range.w; c++)
+			{
+				int const cell = r * cols + c;
+				auto const end = items.begin() + cellFill[cell];
+				auto const found = std::find(items.begin() + cellStart[cell], end, ref);
+				if (found != end)
+				{
+					*found = *(end - 1);
+					cellFill[cell]--;
+				}
+			}
+		}
+	}
+
+	// Puts a removed object back. False when a cell has no room left, which
+	// takes a build to fix.
+	bool add(ObjectRef ref, SDL_FRect const &bounds)
+	{
+		SDL_Rect const range = cellRange(bounds);
+		for (int r = range.y; r < range.y + range.h; r++)
+		{
+			for (int c = range.x; c < range.x + range.w; c++)
+			{
+				if (cellFill[r * cols + c] == cellStart[r * cols + c + 1])
+				{
+					return false;
+				}
+			}
+		}
+		for (int r = range.y; r < range.y + range.h; r++)
+		{
+			for (int c = range.x; c < range.x + range.w; c++)
+			{
+				items[cellFill[r * cols + c]++] = ref;
+			}
+		}
+		return true;
+	}
+
+	// Collects every object sharing a cell with the rectangle, sorted and without
+	// duplicates. When appending, the objects already in out are merged in.
+	void query(SDL_FRect const &rect, std::vector<ObjectRef> &out, bool append = false) const
+	{
+		if (!append)
+		{
+			out.clear();
+		}
+		SDL_Rect const range = cellRange(rect);
+		for (int r = range.y; r < range.y + range.h; r++)
+		{
+			for (int c = range.x; c < range.x + range.w; c++)
+			{
+				int const cell = r * cols + c;
+				out.insert(out.end(), items.begin() + cellStart[cell], items.begin() + cellFill[cell]);
+			}
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+};
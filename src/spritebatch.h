@@ -0,0 +1,68 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include <SDL3/SDL.h>
+#include "render.h"
+
+// Accumulates textured quads and submits every run that shares a texture as a
+// single geometry call. Tints travel as vertex colors, so sprites with
+// different tints still batch together.
+class SpriteBatch
+{
+	RenderContext *gfx;
+	SDL_Texture *texture;
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+public:
+	SpriteBatch() : gfx(nullptr), texture(nullptr)
+	{
+	}
+
+	void setContext(RenderContext *context)
+	{
+		gfx = context;
+	}
+
+	// A negative source width samples the rect mirrored
+	void draw(SDL_Texture *tex, SDL_FRect const &src, SDL_FRect const &dst,
+		SDL_FlipMode flip = SDL_FLIP_NONE, SDL_FColor tint = SDL_FColor { 1.0f, 1.0f, 1.0f, 1.0f })
+	{
+		if (tex != texture)
+		{
+			flush();
+			texture = tex;
+		}
+
+		float const texW = static_cast<float>(tex->w);
+		float const texH = static_cast<float>(tex->h);
+		float u0 = src.x / texW;
+		float u1 = (src.x + src.w) / texW;
+		float const v0 = src.y / texH;
+		float const v1 = (src.y + src.h) / texH;
+		if (flip == SDL_FLIP_HORIZONTAL)
+		{
+			std::swap(u0, u1);
+		}
+
+		int const base = static_cast<int>(vertices.size());
+		vertices.push_back(SDL_Vertex { { dst.x, dst.y }, tint, { u0, v0 } });
+		vertices.push_back(SDL_Vertex { { dst.x + dst.w, dst.y }, tint, { u1, v0 } });
+		vertices.push_back(SDL_Vertex { { dst.x + dst.w, dst.y + dst.h }, tint, { u1, v1 } });
+		vertices.push_back(SDL_Vertex { { dst.x, dst.y + dst.h }, tint, { u0, v1 } });
+		indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+	}
+
+	// Submit pending quads, required before any draw that bypasses the batch
+	void flush()
+	{
+		if (!vertices.empty())
+		{
+			gfx->renderGeometry(texture, vertices.data(), static_cast<int>(vertices.size()),
+				indices.data(), static_cast<int>(indices.size()));
+			vertices.clear();
+			indices.clear();
+		}
+		texture = nullptr;
+	}
+};
@@ -0,0 +1,217 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+#include "xmlscan.h"
+
+// One frame ready to draw: where to sample the sheet and where to put the
+// quad relative to the object's anchor, the bottom center of its box.
+// Mirrored frames have a negative source width.
+struct SpriteFrame
+{
+	SDL_FRect src;
+	SDL_FRect dst;
+};
+
+struct SpriteClip
+{
+	std::string name;
+	std::string image;
+	SDL_Texture *texture = nullptr;     // the image, bound once it is uploaded
+	std::vector<SpriteFrame> frames[2]; // [1] is mirrored horizontally
+	std::vector<float> frameEnds;       // end time of each frame
+	float length;
+	bool loop;
+};
+
+// Animation clips described in a metadata file instead of code. Every clip
+// gets its frame tables built once at load so drawing is a lookup.
+class SpriteSheet
+{
+	std::vector<SpriteClip> clips;
+	std::unordered_map<std::string, int> byName;
+	SpriteClip missing;
+
+	struct FrameDesc
+	{
+		SDL_FRect rect;
+		float duration;
+	};
+
+	void addClip(SpriteClip clip, std::vector<FrameDesc> const &desc, SDL_FPoint pivot, bool pivotSet)
+	{
+		float time = 0;
+		for (FrameDesc const &frame : desc)
+		{
+			SDL_FRect const &r = frame.rect;
+			// Default pivot is the bottom center of the frame
+			SDL_FPoint const p = pivotSet ? pivot : SDL_FPoint { r.w / 2, r.h };
+			clip.frames[0].push_back(SpriteFrame { r, SDL_FRect { -p.x, -p.y, r.w, r.h } });
+			clip.frames[1].push_back(SpriteFrame {
+				SDL_FRect { r.x + r.w, r.y, -r.w, r.h },
+				SDL_FRect { p.x - r.w, -p.y, r.w, r.h },
+			});
+			time += frame.duration;
+			clip.frameEnds.push_back(time);
+		}
+		clip.length = time;
+		byName[clip.name] = static_cast<int>(clips.size());
+		clips.push_back(std::move(clip));
+	}
+
+public:
+	SpriteSheet()
+	{
+		missing.name = "missing";
+		missing.frames[0].push_back(SpriteFrame { });
+		missing.frames[1].push_back(SpriteFrame { });
+		missing.frameEnds.push_back(1);
+		missing.length = 1;
+		missing.loop = true;
+	}
+
+	std::vector<SpriteClip> const &getClips() const { return clips; }
+
+	// Position of a clip in getClips(), -1 for the missing clip
+	int indexOf(SpriteClip const *clip) const
+	{
+		return clip >= clips.data() && clip < clips.data() + clips.size() ? static_cast<int>(clip - clips.data()) : -1;
+	}
+
+	SpriteClip const &clipAt(int index) const
+	{
+		return index >= 0 && index < static_cast<int>(clips.size()) ? clips[index] : missing;
+	}
+
+	// Clips are never added after loading, references stay valid
+	SpriteClip const &clip(std::string const &name) const
+	{
+		auto it = byName.find(name);
+		if (it == byName.end())
+		{
+			SDL_Log("Sprites: no clip named %s", name.c_str());
+			return missing;
+		}
+		return clips[it->second];
+	}
+
+	bool load(std::string const &path)
+	{
+		size_t size = 0;
+		char *text = static_cast<char *>(SDL_LoadFile(path.c_str(), &size));
+		if (!text)
+		{
+			SDL_Log("Sprites: failed to load %s: %s", path.c_str(), SDL_GetError());
+			return false;
+		}
+
+		XmlScanner xml(std::string_view(text, size));
+		SpriteClip clip;
+		std::vector<FrameDesc> desc;
+		SDL_FPoint pivot { };
+		bool pivotSet = false;
+		float frameW = 0, frameH = 0, frameDuration = 0;
+		bool inClip = false;
+		while (xml.next())
+		{
+			if (xml.is("clip"))
+			{
+				clip = SpriteClip { };
+				clip.name = xml.attribute("name");
+				clip.image = xml.attribute("image");
+				clip.loop = xml.attribute("loop") != "false";
+				frameW = xml.floatAttribute("width", 0);
+				frameH = xml.floatAttribute("height", 0);
+				pivotSet = !xml.attribute("pivotx").empty() || !xml.attribute("pivoty").empty();
+				pivot = SDL_FPoint { xml.floatAttribute("pivotx", frameW / 2), xml.floatAttribute("pivoty", frameH) };
+
+				// A strip of equally sized frames unless the clip lists them
+				int const count = xml.intAttribute("frames", 0);
+				frameDuration = count > 0 ? xml.floatAttribute("length", 1) / count : xml.floatAttribute("duration", 0.1f);
+				desc.clear();
+				for (int i = 0; i < count; i++)
+				{
+					desc.push_back(FrameDesc { SDL_FRect { i * frameW, 0, frameW, frameH }, frameDuration });
+				}
+				inClip = !xml.isSelfClosing();
+				if (!inClip)
+				{
+					addClip(clip, desc, pivot, pivotSet);
+				}
+			}
+			else if (xml.is("frame") && inClip)
+			{
+				desc.push_back(FrameDesc {
+					SDL_FRect {
+						xml.floatAttribute("x", 0),
+						xml.floatAttribute("y", 0),
+						xml.floatAttribute("w", frameW),
+						xml.floatAttribute("h", frameH),
+					},
+					xml.floatAttribute("duration", frameDuration),
+				});
+			}
+			else if (xml.isClosing() && xml.name() == "clip" && inClip)
+			{
+				addClip(clip, desc, pivot, pivotSet);
+				inClip = false;
+			}
+		}
+		SDL_free(text);
+
+		for (SpriteClip const &c : clips)
+		{
+			if (c.frameEnds.empty() || c.length <= 0)
+			{
+				SDL_Log("Sprites: clip %s has no frames", c.name.c_str());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Sets the texture of every clip drawn from an image
+	void bindTexture(std::string const &image, SDL_Texture *texture)
+	{
+		for (SpriteClip &c : clips)
+		{
+			if (c.image == image)
+			{
+				c.texture = texture;
+			}
+		}
+	}
+
+	void replaceTexture(SDL_Texture *oldTex, SDL_Texture *newTex)
+	{
+		for (SpriteClip &c : clips)
+		{
+			if (c.texture == oldTex)
+			{
+				c.texture = newTex;
+			}
+		}
+	}
+
+	// Reports frames that reach outside the image of their clip
+	void validate(std::string const &image, int width, int height) const
+	{
+		for (SpriteClip const &c : clips)
+		{
+			if (c.image != image)
+			{
+				continue;
+			}
+			for (SpriteFrame const &frame : c.frames[0])
+			{
+				if (frame.src.x < 0 || frame.src.y < 0 || frame.src.x + frame.src.w > width || frame.src.y + frame.src.h > height)
+				{
+					SDL_Log("Sprites: clip %s has a frame outside of %s", c.name.c_str(), image.c_str());
+					break;
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SDL3/SDL.h>
+
+// Records named startup phases from any thread and reports them once the
+// first frame is presented.
+class StartupProfiler
+{
+	struct Phase
+	{
+		std::string name;
+		std::string thread;
+		Uint64 begin, end;
+	};
+
+	Uint64 origin;
+	std::vector<Phase> phases;
+	SDL_Mutex *mutex;
+	bool reported;
+
+	double toMs(Uint64 ticks) const
+	{
+		return static_cast<double>(ticks - origin) * 1000.0 / SDL_GetPerformanceFrequency();
+	}
+
+public:
+	StartupProfiler() : origin(SDL_GetPerformanceCounter()), mutex(SDL_CreateMutex()), reported(false)
+	{
+	}
+
+	~StartupProfiler()
+	{
+		SDL_DestroyMutex(mutex);
+	}
+
+	// Returns a phase id to pass to end()
+	int begin(std::string const &name, std::string const &thread = "main")
+	{
+		SDL_LockMutex(mutex);
+		phases.push_back(Phase { name, thread, SDL_GetPerformanceCounter(), 0 });
+		int const id = static_cast<int>(phases.size()) - 1;
+		SDL_UnlockMutex(mutex);
+		return id;
+	}
+
+	void end(int id)
+	{
+		Uint64 const now = SDL_GetPerformanceCounter();
+		SDL_LockMutex(mutex);
+		phases[id].end = now;
+		SDL_UnlockMutex(mutex);
+	}
+
+	bool isReported() const { return reported; }
+
+	// Time since process start of profiling, in milliseconds
+	double elapsedMs() const { return toMs(SDL_GetPerformanceCounter()); }
+
+	void report()
+	{
+		reported = true;
+		double const firstFrame = elapsedMs();
+		SDL_LockMutex(mutex);
+		SDL_Log("Startup phases (ms since start):");
+		for (Phase const &phase : phases)
+		{
+			SDL_Log("  %-16s %-10s %8.2f -> %8.2f  (%7.2f)", phase.name.c_str(), phase.thread.c_str(),
+				toMs(phase.begin), toMs(phase.end), toMs(phase.end) - toMs(phase.begin));
+		}
+		SDL_UnlockMutex(mutex);
+		SDL_Log("startup.time_to_first_frame_ms=%.2f", firstFrame);
+	}
+};
+
+// Runs independent startup work on worker threads, each task profiled as a phase
+class TaskGroup
+{
+	struct Task
+	{
+		std::string name;
+		std::function<void()> work;
+		StartupProfiler *profiler;
+		SDL_Thread *thread;
+	};
+	std::vector<std::unique_ptr<Task>> tasks;
+	StartupProfiler *profiler;
+
+	static int runTask(void *data)
+	{
+		Task *task = static_cast<Task *>(data);
+		int const phase = task->profiler->begin(task->name, "worker");
+		task->work();
+		task->profiler->end(phase);
+		return 0;
+	}
+
+public:
+	TaskGroup(StartupProfiler &profiler) : profiler(&profiler)
+	{
+	}
+
+	~TaskGroup()
+	{
+		waitAll();
+	}
+
+	void run(std::string const &name, std::function<void()> work)
+	{
+		tasks.push_back(std::make_unique<Task>(Task { name, std::move(work), profiler, nullptr }));
+		Task *task = tasks.back().get();
+		task->thread = SDL_CreateThread(runTask, name.c_str(), task);
+		if (!task->thread)
+		{
+			// No thread available, run it inline
+			runTask(task);
+		}
+	}
+
+	// Blocks until every task with that name has finished
+	void wait(std::string const &name)
+	{
+		for (auto &task : tasks)
+		{
+			if (task->name == name && task->thread)
+			{
+				SDL_WaitThread(task->thread, nullptr);
+				task->thread = nullptr;
+			}
+		}
+	}
+
+	void waitAll()
+	{
+		for (auto &task : tasks)
+		{
+			if (task->thread)
+			{
+				SDL_WaitThread(task->thread, nullptr);
+				task->thread = nullptr;
+			}
+		}
+	}
+};
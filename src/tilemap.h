@@ -0,0 +1,352 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <SDL3/SDL.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "csvparse.h"
+#include "tileset.h"
+#include "xmlscan.h"
+
+enum class LayerRole
+{
+	background, level, foreground
+};
+
+struct TileLayer
+{
+	std::string name;
+	LayerRole role;
+	std::vector<Uint32> tiles; // row-major gids, flip flags included
+};
+
+struct MapObject
+{
+	std::string name, type;
+	float x, y;
+	Uint32 gid; // set for tile objects
+};
+
+// Orthogonal, finite Tiled map. Layers named Background and Foreground are
+// drawn behind and in front of the characters, every other layer is level.
+struct TileMap
+{
+	int width, height;
+	int tileWidth, tileHeight;
+	Tileset tileset;
+	std::vector<TileLayer> layers;
+	std::vector<MapObject> objects;
+
+	TileMap() : width(0), height(0), tileWidth(0), tileHeight(0)
+	{
+	}
+
+	float getPixelWidth() const { return static_cast<float>(width * tileWidth); }
+	float getPixelHeight() const { return static_cast<float>(height * tileHeight); }
+
+	// Whether a spawn tile or an object of the map places a character of kind
+	bool hasSpawn(char const *kind) const
+	{
+		auto const spawns = [this, kind](Uint32 gid)
+		{
+			return (tileset.getFlags(gid) & TILE_SPAWN) && SDL_strcasecmp(tileset.getSpawn(gid).c_str(), kind) == 0;
+		};
+		for (TileLayer const &layer : layers)
+		{
+			for (Uint32 gid : layer.tiles)
+			{
+				if (spawns(gid & TILE_GID_MASK))
+				{
+					return true;
+				}
+			}
+		}
+		for (MapObject const &object : objects)
+		{
+			if (object.gid ? spawns(object.gid)
+				: SDL_strcasecmp(object.type.c_str(), kind) == 0 || SDL_strcasecmp(object.name.c_str(), kind) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static LayerRole roleOf(std::string_view name)
+	{
+		auto const named = [name](char const *role)
+		{
+			return name.size() == SDL_strlen(role) && SDL_strncasecmp(name.data(), role, name.size()) == 0;
+		};
+		if (named("background"))
+		{
+			return LayerRole::background;
+		}
+		if (named("foreground"))
+		{
+			return LayerRole::foreground;
+		}
+		return LayerRole::level;
+	}
+
+	static bool decodeCsv(std::string_view text, std::vector<Uint32> &tiles)
+	{
+		return CsvTileParser::parse(text.data(), text.size(), tiles.data(), tiles.size()) == tiles.size();
+	}
+
+	// Decodes base64 text into out, whitespace is skipped. Returns the number of
+	// bytes written or -1 on malformed input or when out is too small.
+	static long long decodeBase64(std::string_view text, Uint8 *out, size_t capacity)
+	{
+		static signed char const *const table = []()
+		{
+			static signed char values[256];
+			SDL_memset(values, -1, sizeof(values));
+			char const alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			for (int i = 0; i < 64; i++)
+			{
+				values[static_cast<Uint8>(alphabet[i])] = static_cast<signed char>(i);
+			}
+			return values;
+		}();
+
+		size_t written = 0;
+		Uint32 bits = 0;
+		int count = 0;
+		for (char ch : text)
+		{
+			signed char const value = table[static_cast<Uint8>(ch)];
+			if (value < 0)
+			{
+				if (ch == '=')
+				{
+					break;
+				}
+				if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+				{
+					continue;
+				}
+				return -1;
+			}
+			bits = (bits << 6) | value;
+			if (++count == 4)
+			{
+				if (written + 3 > capacity)
+				{
+					return -1;
+				}
+				out[written++] = static_cast<Uint8>(bits >> 16);
+				out[written++] = static_cast<Uint8>(bits >> 8);
+				out[written++] = static_cast<Uint8>(bits);
+				bits = 0;
+				count = 0;
+			}
+		}
+		// Trailing group of two or three characters carries one or two bytes
+		size_t const tail = count > 1 ? count - 1 : 0;
+		if (count == 1 || written + tail > capacity)
+		{
+			return -1;
+		}
+		if (count >= 2)
+		{
+			out[written++] = static_cast<Uint8>(bits >> (count == 2 ? 4 : 10));
+		}
+		if (count == 3)
+		{
+			out[written++] = static_cast<Uint8>(bits >> 2);
+		}
+		return static_cast<long long>(written);
+	}
+
+	// Base64 layer data, optionally compressed, decoded straight into the tiles
+	static bool decodeBinary(std::string_view text, std::string_view compression, std::vector<Uint32> &tiles)
+	{
+		Uint8 *dst = reinterpret_cast<Uint8 *>(tiles.data());
+		size_t const dstSize = tiles.size() * sizeof(Uint32);
+
+		if (compression.empty())
+		{
+			if (decodeBase64(text, dst, dstSize) != static_cast<long long>(dstSize))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			// Compressed data is never larger than its base64 text
+			std::vector<Uint8> packed(text.size() * 3 / 4 + 3);
+			long long const packedSize = decodeBase64(text, packed.data(), packed.size());
+			if (packedSize < 0)
+			{
+				return false;
+			}
+
+			if (compression == "zlib" || compression == "gzip")
+			{
+				z_stream stream { };
+				stream.next_in = packed.data();
+				stream.avail_in = static_cast<uInt>(packedSize);
+				stream.next_out = dst;
+				stream.avail_out = static_cast<uInt>(dstSize);
+				// Window bits + 32 detects the zlib or gzip header
+				if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK)
+				{
+					return false;
+				}
+				int const result = inflate(&stream, Z_FINISH);
+				inflateEnd(&stream);
+				if (result != Z_STREAM_END || stream.total_out != dstSize)
+				{
+					return false;
+				}
+			}
+			else if (compression == "zstd")
+			{
+#ifdef HAVE_ZSTD
+				size_t const result = ZSTD_decompress(dst, dstSize, packed.data(), static_cast<size_t>(packedSize));
+				if (ZSTD_isError(result) || result != dstSize)
+				{
+					return false;
+				}
+#else
+				SDL_Log("Map: built without zstd support");
+				return false;
+#endif
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		// Tiled writes the gids little-endian
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		for (Uint32 &gid : tiles)
+		{
+			gid = SDL_Swap32LE(gid);
+		}
+#endif
+		return true;
+	}
+
+	// Tile images are looked up by file name in imageDir
+	bool load(std::string const &path, std::string const &imageDir)
+	{
+		size_t size = 0;
+		char *text = static_cast<char *>(SDL_LoadFile(path.c_str(), &size));
+		if (!text)
+		{
+			SDL_Log("Map: failed to load %s: %s", path.c_str(), SDL_GetError());
+			return false;
+		}
+		bool const result = parse(std::string_view(text, size), path, imageDir);
+		SDL_free(text);
+		if (result)
+		{
+			SDL_Log("Map: %s, %dx%d tiles, %d layers, %d objects", path.c_str(), width, height,
+				static_cast<int>(layers.size()), static_cast<int>(objects.size()));
+		}
+		return result;
+	}
+
+	bool parse(std::string_view text, std::string const &path, std::string const &imageDir)
+	{
+		size_t const slash = path.find_last_of("/\\");
+		std::string const dir = slash == std::string::npos ? "." : path.substr(0, slash);
+
+		XmlScanner xml(text);
+		while (xml.next())
+		{
+			if (xml.is("map"))
+			{
+				if (xml.attribute("orientation") != "orthogonal" || xml.intAttribute("infinite", 0))
+				{
+					SDL_Log("Map: %s must be orthogonal and finite", path.c_str());
+					return false;
+				}
+				width = xml.intAttribute("width", 0);
+				height = xml.intAttribute("height", 0);
+				tileWidth = xml.intAttribute("tilewidth", 0);
+				tileHeight = xml.intAttribute("tileheight", 0);
+			}
+			else if (xml.is("tileset"))
+			{
+				Uint32 const firstGid = xml.uintAttribute("firstgid", 1);
+				std::string_view const source = xml.attribute("source");
+				bool loaded = false;
+				if (source.empty())
+				{
+					loaded = tileset.parse(xml.element(), firstGid, imageDir); // embedded in the map
+				}
+				else
+				{
+					bool const absolute = source.front() == '/' || source.find(':') != std::string_view::npos;
+					loaded = tileset.load(absolute ? std::string(source) : dir + "/" + std::string(source), firstGid, imageDir);
+				}
+				if (!loaded)
+				{
+					return false;
+				}
+			}
+			else if (xml.is("layer"))
+			{
+				layers.push_back(TileLayer {
+					std::string(xml.attribute("name")),
+					roleOf(xml.attribute("name")),
+					std::vector<Uint32>(static_cast<size_t>(width) * height, 0),
+				});
+			}
+			else if (xml.is("data") && !layers.empty())
+			{
+				TileLayer &layer = layers.back();
+				std::string_view const encoding = xml.attribute("encoding");
+				std::string_view const compression = xml.attribute("compression");
+				bool decoded = false;
+				if (encoding == "csv")
+				{
+					decoded = decodeCsv(xml.content(), layer.tiles);
+				}
+				else if (encoding == "base64")
+				{
+					decoded = decodeBinary(xml.content(), compression, layer.tiles);
+				}
+				else
+				{
+					SDL_Log("Map: layer %s uses unsupported encoding '%.*s'", layer.name.c_str(),
+						static_cast<int>(encoding.size()), encoding.data());
+					return false;
+				}
+				if (!decoded)
+				{
+					SDL_Log("Map: layer %s is not %d tiles of %.*s %.*s data", layer.name.c_str(), width * height,
+						static_cast<int>(compression.size()), compression.data(),
+						static_cast<int>(encoding.size()), encoding.data());
+					return false;
+				}
+			}
+			else if (xml.is("object"))
+			{
+				// Tiled 1.9 renamed the object type to class
+				std::string_view const type = xml.attribute("type");
+				objects.push_back(MapObject {
+					std::string(xml.attribute("name")),
+					std::string(type.empty() ? xml.attribute("class") : type),
+					xml.floatAttribute("x", 0),
+					xml.floatAttribute("y", 0),
+					xml.uintAttribute("gid", 0) & TILE_GID_MASK,
+				});
+			}
+		}
+
+		if (width <= 0 || height <= 0 || tileWidth <= 0 || tileHeight <= 0)
+		{
+			SDL_Log("Map: %s has no valid size", path.c_str());
+			return false;
+		}
+		return true;
+	}
+};
@@ -0,0 +1,159 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <SDL3/SDL.h>
+#include "xmlscan.h"
+
+// Tile behaviour read from Tiled tile properties
+enum TileFlags : Uint8
+{
+	TILE_SOLID = 1 << 0,
+	TILE_ONE_WAY = 1 << 1,
+	TILE_FOREGROUND = 1 << 2,
+	TILE_ANIMATED = 1 << 3,
+	TILE_SPAWN = 1 << 4,
+	TILE_BREAKABLE = 1 << 5,
+};
+
+// Tiled keeps the flip flags in the top bits of a gid
+Uint32 const TILE_GID_MASK = 0x0fffffff;
+
+// Tile tables of every tileset a map uses, indexed by global tile id so the
+// behaviour of a tile is a single lookup. Gid 0 is the empty tile.
+class Tileset
+{
+	std::vector<Uint8> flags;
+	std::vector<std::string> images; // resolved image path, empty when none
+	std::vector<std::string> spawns; // what a TILE_SPAWN tile spawns
+	int tileWidth, tileHeight;
+
+	void grow(size_t count)
+	{
+		if (count > flags.size())
+		{
+			flags.resize(count, 0);
+			images.resize(count);
+			spawns.resize(count);
+		}
+	}
+
+	// Image paths point wherever the tileset was authored, only the file name is kept
+	static std::string resolveImage(std::string_view source, std::string const &imageDir)
+	{
+		size_t const slash = source.find_last_of("/\\");
+		std::string_view const file = slash == std::string_view::npos ? source : source.substr(slash + 1);
+		return imageDir + "/" + std::string(file);
+	}
+
+	static Uint8 propertyFlag(std::string_view name)
+	{
+		if (name == "solid")
+		{
+			return TILE_SOLID;
+		}
+		if (name == "one-way")
+		{
+			return TILE_ONE_WAY;
+		}
+		if (name == "foreground")
+		{
+			return TILE_FOREGROUND;
+		}
+		if (name == "animated")
+		{
+			return TILE_ANIMATED;
+		}
+		if (name == "breakable")
+		{
+			return TILE_BREAKABLE;
+		}
+		return 0;
+	}
+
+public:
+	Tileset() : flags(1, 0), images(1), spawns(1), tileWidth(0), tileHeight(0)
+	{
+	}
+
+	int getCount() const { return static_cast<int>(flags.size()); }
+	int getTileWidth() const { return tileWidth; }
+	int getTileHeight() const { return tileHeight; }
+
+	// Flag table indexed by gid, getCount() entries
+	Uint8 const *getFlagTable() const { return flags.data(); }
+	Uint8 getFlags(Uint32 gid) const { return gid < flags.size() ? flags[gid] : 0; }
+	std::string const &getImage(Uint32 gid) const { return images[gid]; }
+	std::string const &getSpawn(Uint32 gid) const { return spawns[gid]; }
+
+	bool load(std::string const &path, Uint32 firstGid, std::string const &imageDir)
+	{
+		size_t size = 0;
+		char *text = static_cast<char *>(SDL_LoadFile(path.c_str(), &size));
+		if (!text)
+		{
+			SDL_Log("Tileset: failed to load %s: %s", path.c_str(), SDL_GetError());
+			return false;
+		}
+		bool const result = parse(std::string_view(text, size), firstGid, imageDir);
+		SDL_free(text);
+		if (!result)
+		{
+			SDL_Log("Tileset: %s is not a usable tileset", path.c_str());
+		}
+		return result;
+	}
+
+	// Adds the tiles of one <tileset> element starting at firstGid
+	bool parse(std::string_view text, Uint32 firstGid, std::string const &imageDir)
+	{
+		XmlScanner xml(text);
+		Uint32 gid = 0; // tile being read, 0 outside of a <tile>
+		while (xml.next())
+		{
+			if (xml.is("tileset"))
+			{
+				tileWidth = xml.intAttribute("tilewidth", tileWidth);
+				tileHeight = xml.intAttribute("tileheight", tileHeight);
+				grow(firstGid + xml.intAttribute("tilecount", 0));
+			}
+			else if (xml.is("tile"))
+			{
+				gid = firstGid + xml.intAttribute("id", 0);
+				grow(gid + 1);
+			}
+			else if (xml.isClosing() && xml.name() == "tile")
+			{
+				gid = 0;
+			}
+			else if (xml.is("image"))
+			{
+				if (!gid)
+				{
+					SDL_Log("Tileset: single image tilesets are not supported");
+					return false;
+				}
+				images[gid] = resolveImage(xml.attribute("source"), imageDir);
+			}
+			else if (xml.is("animation") && gid)
+			{
+				flags[gid] |= TILE_ANIMATED;
+			}
+			else if (xml.is("property") && gid)
+			{
+				std::string_view const name = xml.attribute("name");
+				std::string_view const value = xml.attribute("value");
+				if (name == "spawn" && !value.empty())
+				{
+					flags[gid] |= TILE_SPAWN;
+					spawns[gid] = value;
+				}
+				else if (value == "true")
+				{
+					flags[gid] |= propertyFlag(name);
+				}
+			}
+		}
+		return tileWidth > 0 && tileHeight > 0;
+	}
+};
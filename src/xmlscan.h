@@ -0,0 +1,166 @@
+#pragma once
+#include <charconv>
+#include <string>
+#include <string_view>
+
+// Forward-only scanner over the subset of XML written by Tiled: elements,
+// attributes and text content. Comments, declarations and processing
+// instructions are skipped; entities are not expanded.
+class XmlScanner
+{
+	std::string_view text;
+	size_t pos;
+	size_t tagStart;
+	std::string_view tagName;
+	std::string_view attributes; // raw attribute text of the current tag
+	bool closing, selfClosing;
+
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+public:
+	XmlScanner(std::string_view text) : text(text), pos(0), tagStart(0), closing(false), selfClosing(false)
+	{
+	}
+
+	// Advances to the next start or end tag, returns false at the end of the text
+	bool next()
+	{
+		while (true)
+		{
+			size_t const open = text.find('<', pos);
+			if (open == std::string_view::npos || open + 1 >= text.size())
+			{
+				return false;
+			}
+			if (text.compare(open, 4, "<!--") == 0)
+			{
+				size_t const end = text.find("-->", open);
+				if (end == std::string_view::npos)
+				{
+					return false;
+				}
+				pos = end + 3;
+				continue;
+			}
+			size_t const close = text.find('>', open);
+			if (close == std::string_view::npos)
+			{
+				return false;
+			}
+			pos = close + 1;
+			if (text[open + 1] == '?' || text[open + 1] == '!')
+			{
+				continue;
+			}
+
+			std::string_view tag = text.substr(open + 1, close - open - 1);
+			closing = !tag.empty() && tag.front() == '/';
+			if (closing)
+			{
+				tag.remove_prefix(1);
+			}
+			selfClosing = !tag.empty() && tag.back() == '/';
+			if (selfClosing)
+			{
+				tag.remove_suffix(1);
+			}
+			size_t nameEnd = 0;
+			while (nameEnd < tag.size() && !isSpace(tag[nameEnd]))
+			{
+				nameEnd++;
+			}
+			tagName = tag.substr(0, nameEnd);
+			attributes = tag.substr(nameEnd);
+			tagStart = open;
+			return true;
+		}
+	}
+
+	std::string_view name() const { return tagName; }
+	bool isClosing() const { return closing; }
+	bool isSelfClosing() const { return selfClosing; }
+
+	// True for a start tag with the given name
+	bool is(std::string_view element) const { return !closing && tagName == element; }
+
+	// Attribute value of the current tag, empty when missing
+	std::string_view attribute(std::string_view key) const
+	{
+		size_t p = 0;
+		while ((p = attributes.find(key, p)) != std::string_view::npos)
+		{
+			size_t eq = p + key.size();
+			while (eq < attributes.size() && isSpace(attributes[eq]))
+			{
+				eq++;
+			}
+			// Only a whole attribute name counts, not the tail of a longer one
+			if (p > 0 && isSpace(attributes[p - 1]) && eq < attributes.size() && attributes[eq] == '=')
+			{
+				size_t const quote = attributes.find_first_of("\"'", eq);
+				if (quote == std::string_view::npos)
+				{
+					return { };
+				}
+				size_t const end = attributes.find(attributes[quote], quote + 1);
+				if (end == std::string_view::npos)
+				{
+					return { };
+				}
+				return attributes.substr(quote + 1, end - quote - 1);
+			}
+			p += key.size();
+		}
+		return { };
+	}
+
+	int intAttribute(std::string_view key, int fallback) const
+	{
+		std::string_view const value = attribute(key);
+		int result = fallback;
+		std::from_chars(value.data(), value.data() + value.size(), result);
+		return result;
+	}
+
+	unsigned uintAttribute(std::string_view key, unsigned fallback) const
+	{
+		std::string_view const value = attribute(key);
+		unsigned result = fallback;
+		std::from_chars(value.data(), value.data() + value.size(), result);
+		return result;
+	}
+
+	float floatAttribute(std::string_view key, float fallback) const
+	{
+		std::string_view const value = attribute(key);
+		float result = fallback;
+		std::from_chars(value.data(), value.data() + value.size(), result);
+		return result;
+	}
+
+	// Text between the current tag and the next one
+	std::string_view content() const
+	{
+		size_t const end = text.find('<', pos);
+		return text.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos);
+	}
+
+	// The whole current element up to its end tag, which is skipped over.
+	// Nested elements of the same name are not supported.
+	std::string_view element()
+	{
+		if (selfClosing)
+		{
+			return text.substr(tagStart, pos - tagStart);
+		}
+		std::string const endTag = "</" + std::string(tagName) + ">";
+		size_t const end = text.find(endTag, pos);
+		size_t const stop = end == std::string_view::npos ? text.size() : end + endTag.size();
+		std::string_view const whole = text.substr(tagStart, stop - tagStart);
+		pos = stop;
+		return whole;
+	}
+};